@@ -24,8 +24,9 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
-void PrintDissectedFrame(bool a_bWasSent, const std::vector<unsigned char> &a_Buffer) {
+void PrintDissectedFrame(std::ostream& a_OutputStream, bool a_bWasSent, const std::vector<unsigned char> &a_Buffer) {
     // Print dissected HDLC frame
     std::string l_DissectedHDLCFrame;
     if (a_bWasSent) {
@@ -35,7 +36,11 @@ void PrintDissectedFrame(bool a_bWasSent, const std::vector<unsigned char> &a_Bu
     } // else
 
     l_DissectedHDLCFrame.append((const char*)a_Buffer.data(), a_Buffer.size());
-    std::cout << l_DissectedHDLCFrame << std::endl;
+    a_OutputStream << l_DissectedHDLCFrame << std::endl;
+}
+
+void PrintDissectedFrame(bool a_bWasSent, const std::vector<unsigned char> &a_Buffer) {
+    PrintDissectedFrame(std::cout, a_bWasSent, a_Buffer);
 }
 
 #endif // FRAME_PRINTER_H
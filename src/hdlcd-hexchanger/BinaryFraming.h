@@ -0,0 +1,279 @@
+/**
+ * \file BinaryFraming.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARY_FRAMING_H
+#define BINARY_FRAMING_H
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <cstring>
+#include <functional>
+#include <boost/asio.hpp>
+
+typedef enum {
+    BINARY_FRAMING_LENGTH = 0, // Each frame is preceded by its length as 32 bit unsigned integer in network byte order
+    BINARY_FRAMING_SLIP   = 1  // Each frame is terminated by 0xC0, escaped according to RFC 1055
+} E_BINARY_FRAMING;
+
+// SLIP special characters
+enum {
+    SLIP_END     = 0xC0,
+    SLIP_ESC     = 0xDB,
+    SLIP_ESC_END = 0xDC,
+    SLIP_ESC_ESC = 0xDD
+};
+
+class BinaryFrameReader {
+public:
+    // CTOR
+    BinaryFrameReader(boost::asio::io_service& io_service, E_BINARY_FRAMING a_BinaryFraming, size_t a_MaxPayloadSize = 65535):
+        m_InputStream(io_service, ::dup(STDIN_FILENO)), m_BinaryFraming(a_BinaryFraming), m_MaxPayloadSize(a_MaxPayloadSize),
+        m_Buffer(65536), m_Used(0), m_bEscaped(false), m_bDiscard(false), m_bPaused(false), m_bReadPending(false) {
+        // Read frames from STDIN
+        do_read();
+    }
+
+    void SetOnInputLineCallback(std::function<void(const std::vector<unsigned char>)> a_OnInputLineCallback) {
+        m_OnInputLineCallback = a_OnInputLineCallback;
+    }
+
+    // Flow control: stop reading from STDIN after the current chunk, e.g., if too much data is queued for transmission
+    void Pause() {
+        m_bPaused = true;
+    }
+
+    void Resume() {
+        m_bPaused = false;
+        if (!m_bReadPending) {
+            do_read();
+        } // if
+    }
+
+private:
+    // Helpers
+    void do_read() {
+        if (m_Used == m_Buffer.size()) {
+            // A single frame is larger than the buffer
+            m_Buffer.resize(m_Buffer.size() * 2);
+        } // if
+
+        m_bReadPending = true;
+        m_InputStream.async_read_some(boost::asio::buffer(m_Buffer.data() + m_Used, m_Buffer.size() - m_Used), [this](boost::system::error_code a_ErrorCode, size_t a_BytesRead) {
+            if (!a_ErrorCode) {
+                if (m_BinaryFraming == BINARY_FRAMING_LENGTH) {
+                    SplitLengthPrefixed(a_BytesRead);
+                } else {
+                    SplitSlip(a_BytesRead);
+                } // else
+
+                // Read the next chunk
+                m_bReadPending = false;
+                if (!m_bPaused) {
+                    do_read();
+                } // if
+            } else {
+                // Some error occured, or end of file
+                m_InputStream.close();
+            } // else
+        });
+    }
+
+    void SplitLengthPrefixed(size_t a_BytesRead) {
+        m_Used += a_BytesRead;
+        size_t l_Offset = 0;
+        while ((m_Used - l_Offset) >= 4) {
+            const unsigned char* l_Header = &m_Buffer[l_Offset];
+            size_t l_Length = ((size_t(l_Header[0]) << 24) | (size_t(l_Header[1]) << 16) | (size_t(l_Header[2]) << 8) | size_t(l_Header[3]));
+            if (l_Length > m_MaxPayloadSize) {
+                // We lost synchronization or the peer is misbehaving. There is no way to recover.
+                std::cerr << "Binary input: frame length " << l_Length << " exceeds the maximum size, closing STDIN" << std::endl;
+                m_InputStream.close();
+                return;
+            } // if
+
+            if ((m_Used - l_Offset - 4) < l_Length) {
+                if ((l_Length + 4) > m_Buffer.size()) {
+                    m_Buffer.resize(l_Length + 4);
+                } // if
+
+                break;
+            } // if
+
+            Deliver(l_Header + 4, l_Length);
+            l_Offset += (4 + l_Length);
+        } // while
+
+        Compact(l_Offset);
+    }
+
+    void SplitSlip(size_t a_BytesRead) {
+        // Decode in place: the decoded frame never grows beyond the encoded one
+        size_t l_Read = m_Used;
+        size_t l_End = (m_Used + a_BytesRead);
+        size_t l_Write = m_Used;
+        size_t l_FrameStart = 0;
+        for (; l_Read < l_End; ++l_Read) {
+            unsigned char l_Byte = m_Buffer[l_Read];
+            if (m_bEscaped) {
+                m_bEscaped = false;
+                if (l_Byte == SLIP_ESC_END) {
+                    l_Byte = SLIP_END;
+                } else if (l_Byte == SLIP_ESC_ESC) {
+                    l_Byte = SLIP_ESC;
+                } // else if
+            } else if (l_Byte == SLIP_ESC) {
+                m_bEscaped = true;
+                continue;
+            } else if (l_Byte == SLIP_END) {
+                // Empty frames are used to flush line noise, do not deliver them
+                if ((l_Write > l_FrameStart) && (!m_bDiscard)) {
+                    Deliver(&m_Buffer[l_FrameStart], (l_Write - l_FrameStart));
+                } // if
+
+                m_bDiscard = false;
+                l_FrameStart = l_Write;
+                continue;
+            } // else if
+
+            if ((l_Write - l_FrameStart) >= m_MaxPayloadSize) {
+                // Drop the remainder of this frame, resynchronize at the next END character
+                m_bDiscard = true;
+                l_Write = l_FrameStart;
+            } // if
+
+            m_Buffer[l_Write++] = l_Byte;
+        } // for
+
+        m_Used = l_Write;
+        Compact(l_FrameStart);
+    }
+
+    void Compact(size_t a_Consumed) {
+        // Move the incomplete frame to the beginning of the buffer
+        if (a_Consumed) {
+            ::memmove(m_Buffer.data(), m_Buffer.data() + a_Consumed, m_Used - a_Consumed);
+            m_Used -= a_Consumed;
+        } // if
+    }
+
+    void Deliver(const unsigned char* a_Frame, size_t a_Length) {
+        if (m_OnInputLineCallback) {
+            m_OnInputLineCallback(std::vector<unsigned char>(a_Frame, a_Frame + a_Length));
+        } // if
+    }
+
+    // Members
+    std::function<void(const std::vector<unsigned char>)> m_OnInputLineCallback;
+    boost::asio::posix::stream_descriptor m_InputStream;
+    E_BINARY_FRAMING m_BinaryFraming;
+    size_t m_MaxPayloadSize;
+    std::vector<unsigned char> m_Buffer;
+    size_t m_Used;
+    bool m_bEscaped;
+    bool m_bDiscard;
+    bool m_bPaused;
+    bool m_bReadPending;
+};
+
+class BinaryFrameWriter {
+public:
+    // CTOR
+    BinaryFrameWriter(boost::asio::io_service& io_service, E_BINARY_FRAMING a_BinaryFraming):
+        m_OutputStream(io_service, ::dup(STDOUT_FILENO)), m_BinaryFraming(a_BinaryFraming), m_bWriteInProgress(false) {
+    }
+
+    void Write(const std::vector<unsigned char>& a_Payload) {
+        m_PendingFrames.push_back(OutputFrame());
+        OutputFrame& l_OutputFrame = m_PendingFrames.back();
+        if (m_BinaryFraming == BINARY_FRAMING_LENGTH) {
+            size_t l_Length = a_Payload.size();
+            l_OutputFrame.m_Header[0] = (unsigned char)(l_Length >> 24);
+            l_OutputFrame.m_Header[1] = (unsigned char)(l_Length >> 16);
+            l_OutputFrame.m_Header[2] = (unsigned char)(l_Length >> 8);
+            l_OutputFrame.m_Header[3] = (unsigned char)(l_Length);
+            l_OutputFrame.m_Payload = a_Payload;
+        } else {
+            l_OutputFrame.m_Payload.reserve(a_Payload.size() + 2);
+            for (auto it = a_Payload.begin(); it != a_Payload.end(); ++it) {
+                if (*it == SLIP_END) {
+                    l_OutputFrame.m_Payload.push_back(SLIP_ESC);
+                    l_OutputFrame.m_Payload.push_back(SLIP_ESC_END);
+                } else if (*it == SLIP_ESC) {
+                    l_OutputFrame.m_Payload.push_back(SLIP_ESC);
+                    l_OutputFrame.m_Payload.push_back(SLIP_ESC_ESC);
+                } else {
+                    l_OutputFrame.m_Payload.push_back(*it);
+                } // else
+            } // for
+
+            l_OutputFrame.m_Payload.push_back(SLIP_END);
+        } // else
+
+        if (!m_bWriteInProgress) {
+            do_write();
+        } // if
+    }
+
+private:
+    // Helpers
+    void do_write() {
+        // Hand all pending frames over in a single gathered write
+        m_FramesInFlight.swap(m_PendingFrames);
+        std::vector<boost::asio::const_buffer> l_Buffers;
+        l_Buffers.reserve(2 * m_FramesInFlight.size());
+        for (auto it = m_FramesInFlight.begin(); it != m_FramesInFlight.end(); ++it) {
+            if (m_BinaryFraming == BINARY_FRAMING_LENGTH) {
+                l_Buffers.push_back(boost::asio::buffer(it->m_Header));
+            } // if
+
+            l_Buffers.push_back(boost::asio::buffer(it->m_Payload));
+        } // for
+
+        m_bWriteInProgress = true;
+        boost::asio::async_write(m_OutputStream, l_Buffers, [this](boost::system::error_code a_ErrorCode, size_t) {
+            m_bWriteInProgress = false;
+            m_FramesInFlight.clear();
+            if (a_ErrorCode) {
+                // The reader of STDOUT is gone
+                m_PendingFrames.clear();
+                m_OutputStream.close();
+            } else if (!m_PendingFrames.empty()) {
+                do_write();
+            } // else if
+        });
+    }
+
+    // Types
+    struct OutputFrame {
+        unsigned char m_Header[4];
+        std::vector<unsigned char> m_Payload;
+    };
+
+    // Members
+    boost::asio::posix::stream_descriptor m_OutputStream;
+    E_BINARY_FRAMING m_BinaryFraming;
+    bool m_bWriteInProgress;
+    std::deque<OutputFrame> m_PendingFrames;
+    std::deque<OutputFrame> m_FramesInFlight;
+};
+
+#endif // BINARY_FRAMING_H
@@ -24,12 +24,15 @@
 
 #include <iostream>
 #include <vector>
+#include <cstring>
 #include <boost/asio.hpp>
+#include "HexParser.h"
 
 class LineReader {
 public:
     // CTOR
-    LineReader(boost::asio::io_service& io_service): m_InputStream(io_service, ::dup(STDIN_FILENO)), m_InputBuffer(4096), m_InputReader(&m_InputBuffer) {
+    LineReader(boost::asio::io_service& io_service, size_t a_MaxPayloadSize = 65535): m_InputStream(io_service, ::dup(STDIN_FILENO)),
+        m_ReadBuffer(65536), m_HexParser(a_MaxPayloadSize), m_bPaused(false), m_bReadPending(false) {
         // Read single lines of input from STDIN
         do_read();
     }
@@ -37,38 +40,78 @@ public:
     void SetOnInputLineCallback(std::function<void(const std::vector<unsigned char>)> a_OnInputLineCallback) {
         m_OnInputLineCallback = a_OnInputLineCallback;
     }
+
+    // Flow control: stop reading from STDIN after the current chunk, e.g., if too much data is queued for transmission
+    void Pause() {
+        m_bPaused = true;
+    }
+
+    void Resume() {
+        m_bPaused = false;
+        if (!m_bReadPending) {
+            do_read();
+        } // if
+    }
     
 private:
     // Helpers
     void do_read() {
-        boost::asio::async_read_until(m_InputStream, m_InputBuffer, '\n',[this](boost::system::error_code a_ErrorCode, size_t) {
+        // Read large chunks and parse them in place, lines may be of any length and may span multiple chunks
+        m_bReadPending = true;
+        m_InputStream.async_read_some(boost::asio::buffer(m_ReadBuffer),[this](boost::system::error_code a_ErrorCode, size_t a_BytesRead) {
             if (!a_ErrorCode) {
-                // Obtain one line from the input buffer, parse the provided hex dump, and create a StreamFrame from it
-                char l_InputLineBuffer[1000];
-                m_InputReader.getline(l_InputLineBuffer,1000);
-                std::istringstream l_InputStream(l_InputLineBuffer);
-                l_InputStream >> std::hex;
-                std::vector<unsigned char> l_Buffer;
-                l_Buffer.reserve(65536);
-                l_Buffer.insert(l_Buffer.end(),std::istream_iterator<unsigned int>(l_InputStream), {});
-                if (m_OnInputLineCallback) {
-                    m_OnInputLineCallback(std::move(l_Buffer));
-                } // if
+                const char* l_Begin = m_ReadBuffer.data();
+                const char* l_End = (l_Begin + a_BytesRead);
+                while (l_Begin != l_End) {
+                    const char* l_NewLine = (const char*)::memchr(l_Begin, '\n', (l_End - l_Begin));
+                    if (!l_NewLine) {
+                        m_HexParser.Parse(l_Begin, l_End);
+                        break;
+                    } // if
+
+                    // Including the newline: the parser keeps track of the line number for error messages
+                    m_HexParser.Parse(l_Begin, l_NewLine + 1);
+                    DeliverLine();
+                    l_Begin = (l_NewLine + 1);
+                } // while
                 
-                // Read the next line
-                do_read();
+                // Read the next chunk
+                m_bReadPending = false;
+                if (!m_bPaused) {
+                    do_read();
+                } // if
             } else {
-                // Some error occured
+                // Some error occured, or end of file. Deliver a last line that was not terminated.
+                m_HexParser.Finish();
+                if ((!m_HexParser.GetPayload().empty()) || (m_HexParser.GetInvalid())) {
+                    DeliverLine();
+                } // if
+
                 m_InputStream.close();
             } // else
         });
     }
 
+    void DeliverLine() {
+        m_HexParser.Finish();
+        if (m_HexParser.GetInvalid()) {
+            std::cerr << "Input line dropped: " << m_HexParser.GetErrorText() << std::endl;
+        } else if (m_HexParser.GetTooLarge()) {
+            std::cerr << "Input line dropped: the payload exceeds the maximum size" << std::endl;
+        } else if (m_OnInputLineCallback) {
+            m_OnInputLineCallback(std::move(m_HexParser.GetPayload()));
+        } // else if
+
+        m_HexParser.Reset();
+    }
+
     // Members
     std::function<void(const std::vector<unsigned char>)> m_OnInputLineCallback;
     boost::asio::posix::stream_descriptor m_InputStream;
-    boost::asio::streambuf m_InputBuffer;
-    std::istream m_InputReader;
+    std::vector<char> m_ReadBuffer;
+    HexParser m_HexParser;
+    bool m_bPaused;
+    bool m_bReadPending;
 };
 
 #endif // LINE_READER_H
@@ -0,0 +1,317 @@
+/**
+ * \file TransactionCorrelator.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRANSACTION_CORRELATOR_H
+#define TRANSACTION_CORRELATOR_H
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+// Parse a key specification such as "0,1,4-5": byte offsets of the payload that identify a transaction, at most 8 bytes
+std::vector<size_t> ParseCorrelationKey(const std::string& a_KeySpec) {
+    std::vector<size_t> l_Offsets;
+    size_t l_Position = 0;
+    while (l_Position <= a_KeySpec.size()) {
+        size_t l_End = a_KeySpec.find(',', l_Position);
+        if (l_End == std::string::npos) {
+            l_End = a_KeySpec.size();
+        } // if
+
+        std::string l_Range = a_KeySpec.substr(l_Position, (l_End - l_Position));
+        size_t l_Dash = l_Range.find('-');
+        try {
+            size_t l_ParsedLength = 0;
+            size_t l_First = std::stoul(l_Range, &l_ParsedLength);
+            size_t l_Last = l_First;
+            if (l_Dash != std::string::npos) {
+                if (l_ParsedLength != l_Dash) {
+                    throw std::invalid_argument(l_Range);
+                } // if
+
+                l_Last = std::stoul(l_Range.substr(l_Dash + 1), &l_ParsedLength);
+                l_ParsedLength += (l_Dash + 1);
+            } // if
+
+            if ((l_ParsedLength != l_Range.size()) || (l_Last < l_First) || ((l_Offsets.size() + (l_Last - l_First + 1)) > 8)) {
+                throw std::invalid_argument(l_Range);
+            } // if
+
+            for (size_t l_Offset = l_First; l_Offset <= l_Last; ++l_Offset) {
+                l_Offsets.push_back(l_Offset);
+            } // for
+        } catch (std::logic_error&) {
+            throw std::runtime_error("invalid correlation key \"" + a_KeySpec + "\", expected up to 8 byte offsets such as \"0,2-3\"");
+        } // catch
+
+        l_Position = (l_End + 1);
+    } // while
+
+    return l_Offsets;
+}
+
+class TransactionCorrelator {
+public:
+    // CTOR: the table is sized for the given number of outstanding requests at a load factor of at most 75% and never resized
+    TransactionCorrelator(boost::asio::io_service& a_IoService, const std::vector<size_t>& a_KeyOffsets, size_t a_NbrOfSlots,
+                          std::chrono::milliseconds a_Timeout):
+        m_KeyOffsets(a_KeyOffsets), m_MinimumLength(0), m_Mask(0), m_MaxOutstanding(a_NbrOfSlots), m_NbrOfOutstanding(0), m_Timeout(a_Timeout), m_ExpiryTimer(a_IoService),
+        m_bExpiryScheduled(false), m_NbrOfRequests(0), m_NbrOfResponses(0), m_NbrOfUnmatched(0), m_NbrOfTimeouts(0), m_NbrOfDuplicates(0),
+        m_NbrOfOverflows(0), m_NbrOfShortFrames(0), m_MinLatency(std::chrono::steady_clock::duration::max()),
+        m_MaxLatency(std::chrono::steady_clock::duration::zero()), m_SumLatency(std::chrono::steady_clock::duration::zero()) {
+        for (auto it = m_KeyOffsets.begin(); it != m_KeyOffsets.end(); ++it) {
+            m_MinimumLength = std::max(m_MinimumLength, (*it + 1));
+        } // for
+
+        // Rounded up to a power of two
+        size_t l_NbrOfSlots = 16;
+        while (l_NbrOfSlots < (((a_NbrOfSlots * 4) + 2) / 3)) {
+            l_NbrOfSlots <<= 1;
+        } // while
+
+        m_Slots.resize(l_NbrOfSlots);
+        m_Mask = (l_NbrOfSlots - 1);
+        for (size_t l_Index = 0; l_Index < E_NBR_OF_BUCKETS; ++l_Index) {
+            m_Histogram[l_Index] = 0;
+        } // for
+    }
+
+    // A request left the send queue, i.e., the latency does not include the time spent in the send window
+    void OnSent(const std::vector<unsigned char>& a_Payload, std::chrono::steady_clock::time_point a_Sent) {
+        uint64_t l_Key;
+        if (!GetKey(a_Payload, l_Key)) {
+            ++m_NbrOfShortFrames;
+            return;
+        } // if
+
+        ++m_NbrOfRequests;
+        if (Find(l_Key) != m_Slots.size()) {
+            // The response cannot be assigned unambiguously, keep the older request
+            ++m_NbrOfDuplicates;
+            return;
+        } // if
+
+        if (m_NbrOfOutstanding >= m_MaxOutstanding) {
+            ++m_NbrOfOverflows;
+            return;
+        } // if
+
+        size_t l_Index = Home(l_Key);
+        while (m_Slots[l_Index].m_bUsed) {
+            l_Index = ((l_Index + 1) & m_Mask);
+        } // while
+
+        m_Slots[l_Index].m_bUsed = true;
+        m_Slots[l_Index].m_Key = l_Key;
+        m_Slots[l_Index].m_Sent = a_Sent;
+        ++m_NbrOfOutstanding;
+        ScheduleExpiry();
+    }
+
+    // A frame was received: the first one carrying the key of an outstanding request completes it
+    void OnRcvd(const std::vector<unsigned char>& a_Payload, std::chrono::steady_clock::time_point a_Received) {
+        uint64_t l_Key;
+        if (!GetKey(a_Payload, l_Key)) {
+            ++m_NbrOfShortFrames;
+            return;
+        } // if
+
+        size_t l_Index = Find(l_Key);
+        if (l_Index == m_Slots.size()) {
+            ++m_NbrOfUnmatched;
+            return;
+        } // if
+
+        auto l_Latency = (a_Received - m_Slots[l_Index].m_Sent);
+        Erase(l_Index);
+        ++m_NbrOfResponses;
+        m_MinLatency = std::min(m_MinLatency, l_Latency);
+        m_MaxLatency = std::max(m_MaxLatency, l_Latency);
+        m_SumLatency += l_Latency;
+        uint64_t l_Microseconds = std::chrono::duration_cast<std::chrono::microseconds>(l_Latency).count();
+        size_t l_Bucket = 0;
+        while ((l_Microseconds > 1) && (l_Bucket < (E_NBR_OF_BUCKETS - 1))) {
+            l_Microseconds >>= 1;
+            ++l_Bucket;
+        } // while
+
+        ++m_Histogram[l_Bucket];
+    }
+
+    void PrintStatistics(std::ostream& a_OutputStream) const {
+        a_OutputStream << std::dec << "Transactions: " << m_NbrOfRequests << " requests, " << m_NbrOfResponses << " responses, "
+                       << m_NbrOfTimeouts << " timeouts, " << m_NbrOfOutstanding << " outstanding, " << m_NbrOfUnmatched << " unmatched frames, "
+                       << m_NbrOfDuplicates << " duplicate keys, " << m_NbrOfOverflows << " table overflows, "
+                       << m_NbrOfShortFrames << " frames too short for the key" << std::endl;
+        if (!m_NbrOfResponses) {
+            return;
+        } // if
+
+        a_OutputStream << std::fixed << std::setprecision(3) << "Latency: min " << ToMilliseconds(m_MinLatency) << " ms, avg "
+                       << (ToMilliseconds(m_SumLatency) / m_NbrOfResponses) << " ms, max " << ToMilliseconds(m_MaxLatency) << " ms" << std::endl;
+
+        // One bucket per power of two of microseconds
+        size_t l_MaxCount = 0;
+        for (size_t l_Index = 0; l_Index < E_NBR_OF_BUCKETS; ++l_Index) {
+            l_MaxCount = std::max(l_MaxCount, m_Histogram[l_Index]);
+        } // for
+
+        size_t l_Accumulated = 0;
+        for (size_t l_Index = 0; l_Index < E_NBR_OF_BUCKETS; ++l_Index) {
+            if (!m_Histogram[l_Index]) {
+                continue;
+            } // if
+
+            l_Accumulated += m_Histogram[l_Index];
+            a_OutputStream << "  < " << std::setw(12) << (ToMilliseconds(std::chrono::microseconds(uint64_t(2) << l_Index))) << " ms "
+                           << std::setw(8) << m_Histogram[l_Index] << std::setw(8) << std::setprecision(1)
+                           << (100.0 * l_Accumulated / m_NbrOfResponses) << "% " << std::string((m_Histogram[l_Index] * 40 + l_MaxCount - 1) / l_MaxCount, '#')
+                           << std::setprecision(3) << std::endl;
+        } // for
+    }
+
+private:
+    // Helpers
+    bool GetKey(const std::vector<unsigned char>& a_Payload, uint64_t& a_Key) const {
+        if (a_Payload.size() < m_MinimumLength) {
+            return false;
+        } // if
+
+        a_Key = 0;
+        for (auto it = m_KeyOffsets.begin(); it != m_KeyOffsets.end(); ++it) {
+            a_Key = ((a_Key << 8) | a_Payload[*it]);
+        } // for
+
+        return true;
+    }
+
+    size_t Home(uint64_t a_Key) const {
+        // Fibonacci hashing: keys often differ in the lowest bits only
+        return ((a_Key * 0x9E3779B97F4A7C15ull) >> 32) & m_Mask;
+    }
+
+    size_t Find(uint64_t a_Key) const {
+        // Linear probing, returns the number of slots if not found
+        for (size_t l_Index = Home(a_Key); m_Slots[l_Index].m_bUsed; l_Index = ((l_Index + 1) & m_Mask)) {
+            if (m_Slots[l_Index].m_Key == a_Key) {
+                return l_Index;
+            } // if
+        } // for
+
+        return m_Slots.size();
+    }
+
+    void Erase(size_t a_Index) {
+        // Backward shift deletion: no tombstones, the probe sequences stay short
+        m_Slots[a_Index].m_bUsed = false;
+        --m_NbrOfOutstanding;
+        for (size_t l_Index = ((a_Index + 1) & m_Mask); m_Slots[l_Index].m_bUsed; l_Index = ((l_Index + 1) & m_Mask)) {
+            size_t l_Home = Home(m_Slots[l_Index].m_Key);
+            if (((l_Index - l_Home) & m_Mask) >= ((l_Index - a_Index) & m_Mask)) {
+                m_Slots[a_Index] = m_Slots[l_Index];
+                m_Slots[l_Index].m_bUsed = false;
+                a_Index = l_Index;
+            } // if
+        } // for
+    }
+
+    void ScheduleExpiry() {
+        if (m_bExpiryScheduled) {
+            return;
+        } // if
+
+        // Expired requests are collected at a granularity of half the timeout
+        m_bExpiryScheduled = true;
+        m_ExpiryTimer.expires_from_now(m_Timeout / 2);
+        m_ExpiryTimer.async_wait([this](const boost::system::error_code& a_ErrorCode) {
+            m_bExpiryScheduled = false;
+            if (a_ErrorCode) {
+                return;
+            } // if
+
+            auto l_Deadline = (std::chrono::steady_clock::now() - m_Timeout);
+            for (size_t l_Index = 0; l_Index < m_Slots.size(); ) {
+                if ((m_Slots[l_Index].m_bUsed) && (m_Slots[l_Index].m_Sent <= l_Deadline)) {
+                    // Erase() may shift another entry into this slot, check it again
+                    Erase(l_Index);
+                    ++m_NbrOfTimeouts;
+                } else {
+                    ++l_Index;
+                } // else
+            } // for
+
+            if (m_NbrOfOutstanding) {
+                ScheduleExpiry();
+            } // if
+        });
+    }
+
+    static double ToMilliseconds(std::chrono::steady_clock::duration a_Duration) {
+        return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(a_Duration).count();
+    }
+
+    // Constants
+    enum {
+        E_NBR_OF_BUCKETS = 32
+    };
+
+    // Types
+    struct Slot {
+        Slot(): m_bUsed(false), m_Key(0) {
+        }
+
+        bool m_bUsed;
+        uint64_t m_Key;
+        std::chrono::steady_clock::time_point m_Sent;
+    };
+
+    // Members
+    std::vector<size_t> m_KeyOffsets;
+    size_t m_MinimumLength;
+    std::vector<Slot> m_Slots;
+    size_t m_Mask;
+    size_t m_MaxOutstanding;
+    size_t m_NbrOfOutstanding;
+    std::chrono::milliseconds m_Timeout;
+    boost::asio::steady_timer m_ExpiryTimer;
+    bool m_bExpiryScheduled;
+
+    // Statistics
+    size_t m_NbrOfRequests;
+    size_t m_NbrOfResponses;
+    size_t m_NbrOfUnmatched;
+    size_t m_NbrOfTimeouts;
+    size_t m_NbrOfDuplicates;
+    size_t m_NbrOfOverflows;
+    size_t m_NbrOfShortFrames;
+    std::chrono::steady_clock::duration m_MinLatency;
+    std::chrono::steady_clock::duration m_MaxLatency;
+    std::chrono::steady_clock::duration m_SumLatency;
+    size_t m_Histogram[E_NBR_OF_BUCKETS];
+};
+
+#endif // TRANSACTION_CORRELATOR_H
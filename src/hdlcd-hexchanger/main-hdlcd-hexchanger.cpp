@@ -22,12 +22,17 @@
 #include "Config.h"
 #include <iostream>
 #include <vector>
+#include <memory>
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
 #include <boost/regex.hpp>
 #include "HdlcdClient.h"
 #include "HdlcdPacketDataPrinter.h"
+#include "HdlcdSessionTraits.h"
 #include "LineReader.h"
+#include "BinaryFraming.h"
+#include "SendWindow.h"
+#include "TransactionCorrelator.h"
 
 int main(int argc, char* argv[]) {
     try {
@@ -41,6 +46,25 @@ int main(int argc, char* argv[]) {
                           "syntax: SerialPort@IPAddess:PortNbr\n"
                           "  linux:   /dev/ttyUSB0@localhost:5001\n"
                           "  windows: //./COM1@example.com:5001")
+            ("max-size",  boost::program_options::value<size_t>()->default_value(65535),
+                          "maximum payload size of a single input line or frame in bytes")
+            ("binary,b",  boost::program_options::value<std::string>(),
+                          "exchange binary frames via STDIO instead of hex dumps\n"
+                          "length: 32 bit length prefix, network byte order\n"
+                          "slip:   SLIP encoding according to RFC 1055")
+            ("window-bytes", boost::program_options::value<size_t>()->default_value(65536),
+                          "pause reading STDIN if N bytes are queued for transmission")
+            ("window-frames", boost::program_options::value<size_t>()->default_value(256),
+                          "pause reading STDIN if N frames are queued for transmission")
+            ("window-stats", "print queue depth and wait time statistics to STDERR on exit")
+            ("correlate",  boost::program_options::value<std::string>(),
+                          "match each sent payload with the first received payload\n"
+                          "carrying the same key, given as byte offsets, e.g., \"0,2-3\".\n"
+                          "Prints latency statistics to STDERR on exit")
+            ("correlate-timeout", boost::program_options::value<unsigned int>()->default_value(1000),
+                          "drop outstanding transactions after N milliseconds")
+            ("correlate-slots", boost::program_options::value<size_t>()->default_value(1024),
+                          "maximum number of outstanding transactions")
         ;
 
         // Parse the command line
@@ -65,6 +89,22 @@ int main(int argc, char* argv[]) {
             return 1;
         } // if
 
+        E_BINARY_FRAMING l_BinaryFraming = BINARY_FRAMING_LENGTH;
+        if (l_VariablesMap.count("binary")) {
+            if (l_VariablesMap["binary"].as<std::string>() == "slip") {
+                l_BinaryFraming = BINARY_FRAMING_SLIP;
+            } else if (l_VariablesMap["binary"].as<std::string>() != "length") {
+                std::cout << "hdlcd-hexchanger: the binary framing must be either \"length\" or \"slip\"" << std::endl;
+                std::cout << "hdlcd-hexchanger: Use --help for more information." << std::endl;
+                return 1;
+            } // else if
+        } // if
+
+        std::vector<size_t> l_KeyOffsets;
+        if (l_VariablesMap.count("correlate")) {
+            l_KeyOffsets = ParseCorrelationKey(l_VariablesMap["correlate"].as<std::string>());
+        } // if
+
         // Install signal handlers
         boost::asio::io_service l_IoService;
         boost::asio::signal_set l_Signals(l_IoService);
@@ -80,16 +120,74 @@ int main(int argc, char* argv[]) {
             boost::asio::ip::tcp::resolver l_Resolver(l_IoService);
             auto l_EndpointIterator = l_Resolver.resolve({ l_Match[2], l_Match[3] });
             
-            // Prepare input
-            LineReader l_LineReader(l_IoService);
-            
-            // Prepare the HDLCd client entity
-            HdlcdClient l_HdlcdClient(l_IoService, l_Match[1], HdlcdSessionDescriptor(SESSION_TYPE_TRX_ALL, SESSION_FLAGS_DELIVER_RCVD));
+            // Prepare input and output: either hex dumps or binary frames
+            std::unique_ptr<LineReader> l_LineReader;
+            std::unique_ptr<BinaryFrameReader> l_BinaryFrameReader;
+            std::unique_ptr<BinaryFrameWriter> l_BinaryFrameWriter;
+            if (l_VariablesMap.count("binary")) {
+                l_BinaryFrameReader.reset(new BinaryFrameReader(l_IoService, l_BinaryFraming, l_VariablesMap["max-size"].as<size_t>()));
+                l_BinaryFrameWriter.reset(new BinaryFrameWriter(l_IoService, l_BinaryFraming));
+            } else {
+                l_LineReader.reset(new LineReader(l_IoService, l_VariablesMap["max-size"].as<size_t>()));
+            } // else
+
+            // Prepare request/response correlation
+            std::unique_ptr<TransactionCorrelator> l_TransactionCorrelator;
+            if (!l_KeyOffsets.empty()) {
+                l_TransactionCorrelator.reset(new TransactionCorrelator(l_IoService, l_KeyOffsets, l_VariablesMap["correlate-slots"].as<size_t>(),
+                                                                        std::chrono::milliseconds(std::max(2u, l_VariablesMap["correlate-timeout"].as<unsigned int>()))));
+            } // if
+
+            // Prepare the HDLCd client entity: received frames only
+            typedef HdlcdSessionTraits<SESSION_TYPE_TRX_ALL, false, true> Session;
+            HdlcdClient l_HdlcdClient(l_IoService, l_Match[1], Session::CreateSessionDescriptor());
             l_HdlcdClient.SetOnClosedCallback([&l_IoService](){ l_IoService.stop(); });
-            l_HdlcdClient.SetOnDataCallback([](const HdlcdPacketData& a_PacketData){ HdlcdPacketDataPrinter(a_PacketData); });
-            l_HdlcdClient.AsyncConnect(l_EndpointIterator, [&l_HdlcdClient, &l_LineReader, &l_Signals](bool a_bSuccess) {
+            l_HdlcdClient.SetOnDataCallback([&l_BinaryFrameWriter, &l_TransactionCorrelator](const HdlcdPacketData& a_PacketData) {
+                if (l_TransactionCorrelator) {
+                    // Stamp before any output is written
+                    l_TransactionCorrelator->OnRcvd(a_PacketData.GetData(), std::chrono::steady_clock::now());
+                } // if
+
+                if (l_BinaryFrameWriter) {
+                    l_BinaryFrameWriter->Write(a_PacketData.GetData());
+                } else {
+                    HdlcdPacketDataHexPrinter<Session>(std::cout, false, a_PacketData.GetInvalid(), a_PacketData.GetData());
+                } // else
+            });
+            SendWindow l_SendWindow(l_HdlcdClient, l_VariablesMap["window-bytes"].as<size_t>(), l_VariablesMap["window-frames"].as<size_t>());
+            l_SendWindow.SetOnPauseCallback([&l_LineReader, &l_BinaryFrameReader]() {
+                if (l_BinaryFrameReader) {
+                    l_BinaryFrameReader->Pause();
+                } else {
+                    l_LineReader->Pause();
+                } // else
+            });
+            l_SendWindow.SetOnResumeCallback([&l_LineReader, &l_BinaryFrameReader]() {
+                if (l_BinaryFrameReader) {
+                    l_BinaryFrameReader->Resume();
+                } else {
+                    l_LineReader->Resume();
+                } // else
+            });
+
+            l_HdlcdClient.AsyncConnect(l_EndpointIterator, [&l_SendWindow, &l_LineReader, &l_BinaryFrameReader, &l_TransactionCorrelator, &l_Signals](bool a_bSuccess) {
                 if (a_bSuccess) {
-                    l_LineReader.SetOnInputLineCallback([&l_HdlcdClient](const std::vector<unsigned char> a_Buffer){ l_HdlcdClient.Send(HdlcdPacketData::CreatePacket(a_Buffer, true));});
+                    auto l_OnInputCallback = [&l_SendWindow, &l_TransactionCorrelator](const std::vector<unsigned char> a_Buffer) {
+                        if (l_TransactionCorrelator) {
+                            // Stamp the request when it is actually sent, not when it is queued
+                            l_SendWindow.Send(HdlcdPacketData::CreatePacket(a_Buffer, true), [&l_TransactionCorrelator, a_Buffer]() {
+                                l_TransactionCorrelator->OnSent(a_Buffer, std::chrono::steady_clock::now());
+                            });
+                        } else {
+                            l_SendWindow.Send(HdlcdPacketData::CreatePacket(a_Buffer, true));
+                        } // else
+                    };
+
+                    if (l_BinaryFrameReader) {
+                        l_BinaryFrameReader->SetOnInputLineCallback(l_OnInputCallback);
+                    } else {
+                        l_LineReader->SetOnInputLineCallback(l_OnInputCallback);
+                    } // else
                 } else {
                     std::cout << "Failed to connect to the HDLC Daemon!" << std::endl;
                     l_Signals.cancel();
@@ -98,6 +196,13 @@ int main(int argc, char* argv[]) {
 
             // Start event processing
             l_IoService.run();
+            if (l_VariablesMap.count("window-stats")) {
+                l_SendWindow.PrintStatistics(std::cerr);
+            } // if
+
+            if (l_TransactionCorrelator) {
+                l_TransactionCorrelator->PrintStatistics(std::cerr);
+            } // if
         } else {
             throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value);
         } // else
@@ -21,11 +21,18 @@
 
 #include "Config.h"
 #include <iostream>
+#include <memory>
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
 #include <boost/regex.hpp>
 #include "HdlcdClient.h"
 #include "HdlcdPacketDataPrinter.h"
+#include "HdlcdSessionTraits.h"
+#include "FormattingPipeline.h"
+#include "StageProfiler.h"
+#include "FrameSampler.h"
+#include "PayloadDecoders.h"
+#include "StructuredPrinter.h"
 
 int main(int argc, char* argv[]) {
     try {
@@ -39,8 +46,18 @@ int main(int argc, char* argv[]) {
                           "syntax: SerialPort@IPAddess:PortNbr\n"
                           "  linux:   /dev/ttyUSB0@localhost:5001\n"
                           "  windows: //./COM1@example.com:5001")
+            ("threads,t", boost::program_options::value<unsigned int>()->default_value(0),
+                          "number of worker threads to format frames\n"
+                          "0: format on the network thread (default)")
+            ("decode,d",  "decode known messages of the application protocol\n"
+                          "(text format only)")
+            ("timestamps", "prefix each frame with its time of arrival (UTC)")
+            ("format",    boost::program_options::value<std::string>()->default_value("text"),
+                          "output format: text, json, or cbor")
         ;
 
+        AddSamplingOptions(l_Description);
+
         // Parse the command line
         boost::program_options::variables_map l_VariablesMap;
         boost::program_options::store(boost::program_options::parse_command_line(argc, argv, l_Description), l_VariablesMap);
@@ -63,12 +80,25 @@ int main(int argc, char* argv[]) {
             return 1;
         } // if
 
+        E_OUTPUT_FORMAT l_OutputFormat;
+        if (!ParseOutputFormat(l_VariablesMap["format"].as<std::string>(), l_OutputFormat)) {
+            std::cout << "hdlcd-hexdump-payload: the output format must be \"text\", \"json\", or \"cbor\"" << std::endl;
+            return 1;
+        } // if
+
+        SamplingOptions l_SamplingOptions;
+        if (!ParseSamplingOptions(l_VariablesMap, l_SamplingOptions)) {
+            std::cout << "hdlcd-hexdump-payload: the sampling must be \"every:N\", \"reservoir:N\", or \"rate:N\" with N > 0" << std::endl;
+            return 1;
+        } // if
+
         // Install signal handlers
         boost::asio::io_service l_IoService;
         boost::asio::signal_set l_Signals(l_IoService);
         l_Signals.add(SIGINT);
         l_Signals.add(SIGTERM);
         l_Signals.async_wait([&l_IoService](boost::system::error_code, int){ l_IoService.stop(); });
+        STAGE_PROFILER_DUMPER(l_IoService);
         
         // Parse the destination specifier
         static boost::regex s_RegEx("^(.*?)@(.*?):(.*?)$");
@@ -78,19 +108,78 @@ int main(int argc, char* argv[]) {
             boost::asio::ip::tcp::resolver l_Resolver(l_IoService);
             auto l_EndpointIterator = l_Resolver.resolve({ l_Match[2], l_Match[3] });
 
+            // Prepare the formatter of a single frame, including the optional payload decoders
+            typedef HdlcdSessionTraits<SESSION_TYPE_RX_PAYLOAD, true, true> Session;
+            const DefaultPayloadDecoderRegistry l_PayloadDecoderRegistry;
+            bool l_bDecode = l_VariablesMap.count("decode");
+            bool l_bTimestamps = l_VariablesMap.count("timestamps");
+            const StructuredPrinter l_StructuredPrinter(l_OutputFormat, l_Match[1].str());
+            auto l_PrintFrame = [l_OutputFormat, l_bDecode, l_bTimestamps, &l_PayloadDecoderRegistry, &l_StructuredPrinter](std::ostream& a_OutputStream, bool a_bWasSent, bool a_bInvalid,
+                                                                                                                           const FrameTimestamp& a_FrameTimestamp, const std::vector<unsigned char>& a_Buffer) {
+                STAGE_PROFILER_SCOPE(PROFILER_STAGE_FORMAT);
+                if (l_OutputFormat != OUTPUT_FORMAT_TEXT) {
+                    l_StructuredPrinter.Print(a_OutputStream, a_bWasSent, a_bInvalid, a_FrameTimestamp, a_Buffer);
+                    return;
+                } // if
+
+                if (l_bTimestamps) {
+                    PrintFrameTimestamp(a_OutputStream, a_FrameTimestamp);
+                } // if
+
+                HdlcdPacketDataHexPrinter<Session>(a_OutputStream, a_bWasSent, a_bInvalid, a_Buffer);
+                if (l_bDecode) {
+                    l_PayloadDecoderRegistry.Decode(a_OutputStream, a_Buffer);
+                } // if
+            };
+
+            // Prepare the optional formatting pipeline, decoupled from the network thread
+            std::unique_ptr<FormattingPipeline> l_FormattingPipeline;
+            if (l_VariablesMap["threads"].as<unsigned int>()) {
+                l_FormattingPipeline.reset(new FormattingPipeline(l_VariablesMap["threads"].as<unsigned int>(), [&l_PrintFrame](std::ostream& a_OutputStream, const FormattingPipelineEntry& a_Entry) {
+                    l_PrintFrame(a_OutputStream, a_Entry.m_bWasSent, a_Entry.m_bInvalid, a_Entry.m_Timestamp, a_Entry.m_Buffer);
+                }));
+            } // if
+
+            // Prepare the optional sampler: it decides before a frame is copied or formatted
+            auto l_OnFrame = [&l_FormattingPipeline, &l_PrintFrame](bool a_bWasSent, bool a_bInvalid, const FrameTimestamp& a_FrameTimestamp,
+                                                                    const std::vector<unsigned char>& a_Buffer) {
+                if (l_FormattingPipeline) {
+                    l_FormattingPipeline->Push(a_bWasSent, a_bInvalid, a_FrameTimestamp, a_Buffer);
+                } else {
+                    l_PrintFrame(std::cout, a_bWasSent, a_bInvalid, a_FrameTimestamp, a_Buffer);
+                } // else
+            };
+
+            std::unique_ptr<FrameSampler> l_FrameSampler(CreateFrameSampler(l_IoService, l_SamplingOptions, l_OnFrame));
+
             // Prepare the HDLCd client entity
-            HdlcdClient l_HdlcdClient(l_IoService, l_Match[1], HdlcdSessionDescriptor(SESSION_TYPE_RX_PAYLOAD, (SESSION_FLAGS_DELIVER_SENT | SESSION_FLAGS_DELIVER_RCVD)));
+            HdlcdClient l_HdlcdClient(l_IoService, l_Match[1], Session::CreateSessionDescriptor());
             l_HdlcdClient.SetOnClosedCallback([&l_IoService](){ l_IoService.stop(); });
-            l_HdlcdClient.SetOnDataCallback([](const HdlcdPacketData& a_PacketData){ HdlcdPacketDataPrinter(a_PacketData); });
-            l_HdlcdClient.AsyncConnect(l_EndpointIterator, [&l_Signals](bool a_bSuccess) {
+            l_HdlcdClient.SetOnDataCallback([&l_FrameSampler, &l_OnFrame](const HdlcdPacketData& a_PacketData) {
+                STAGE_PROFILER_SCOPE(PROFILER_STAGE_RECEIVE);
+                FrameTimestamp l_FrameTimestamp(FrameTimestamp::Now());
+                if (l_FrameSampler) {
+                    l_FrameSampler->OnData(a_PacketData, l_FrameTimestamp);
+                } else {
+                    l_OnFrame(a_PacketData.GetWasSent(), a_PacketData.GetInvalid(), l_FrameTimestamp, a_PacketData.GetData());
+                } // else
+            });
+            l_HdlcdClient.AsyncConnect(l_EndpointIterator, [&](bool a_bSuccess) {
                 if (!a_bSuccess) {
                     std::cout << "Failed to connect to the HDLC Daemon!" << std::endl;
                     l_Signals.cancel();
+                    STAGE_PROFILER_CANCEL();
+                    if (l_FrameSampler) {
+                        l_FrameSampler->Cancel();
+                    } // if
                 } // if
             }); // AsyncConnect
 
             // Start event processing
             l_IoService.run();
+            if (l_FrameSampler) {
+                l_FrameSampler->Flush();
+            } // if
         } else {
             throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value);
         } // else
@@ -0,0 +1,212 @@
+/**
+ * \file FlightRecorder.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "HdlcdClient.h"
+#include "HdlcdPacketDataPrinter.h"
+#include "FrameRingBuffer.h"
+#include "PcapWriter.h"
+#include "FrameTimestamp.h"
+
+class FlightRecorder {
+public:
+    // CTOR: frames are only copied into the ring buffer, formatting and writing is done by the dump thread if a trigger fires
+    FlightRecorder(size_t a_Capacity, const std::string& a_FilePrefix, bool a_bPcap, std::chrono::seconds a_HoldOff,
+                   bool a_bHugePages = false, int a_NumaNode = -1):
+        m_FrameRingBuffer(a_Capacity, a_bHugePages, a_NumaNode), m_FilePrefix(a_FilePrefix), m_bPcap(a_bPcap), m_HoldOff(a_HoldOff),
+        m_bTriggerOnInvalid(false), m_bTriggerOnStatusChange(false), m_bHavePortStatus(false),
+        m_bAlive(false), m_bLockedBySelf(false), m_bLockedByOthers(false), m_NbrOfDumps(0),
+        m_Snapshot(a_Capacity, a_bHugePages, a_NumaNode), m_bDumpPending(false), m_bDumpStopped(false) {
+        m_DumpThread = std::thread([this](){ DumpLoop(); });
+    }
+
+    // DTOR: a pending dump is completed first
+    ~FlightRecorder() {
+        {
+            std::lock_guard<std::mutex> l_Lock(m_DumpMutex);
+            m_bDumpStopped = true;
+        }
+
+        m_DumpCondition.notify_one();
+        m_DumpThread.join();
+    }
+
+    void SetTriggerPattern(const std::vector<unsigned char>& a_TriggerPattern) {
+        m_TriggerPattern = a_TriggerPattern;
+    }
+
+    void SetTriggerOnInvalid(bool a_bTriggerOnInvalid) {
+        m_bTriggerOnInvalid = a_bTriggerOnInvalid;
+    }
+
+    void SetTriggerOnStatusChange(bool a_bTriggerOnStatusChange) {
+        m_bTriggerOnStatusChange = a_bTriggerOnStatusChange;
+    }
+
+    void OnData(const HdlcdPacketData& a_PacketData, const FrameTimestamp& a_FrameTimestamp) {
+        const std::vector<unsigned char>& l_Buffer = a_PacketData.GetData();
+        m_FrameRingBuffer.Push(a_PacketData.GetWasSent(), a_PacketData.GetInvalid(), a_FrameTimestamp.GetMicroseconds(), l_Buffer);
+        if ((m_bTriggerOnInvalid) && (a_PacketData.GetInvalid())) {
+            Trigger("broken frame");
+        } else if ((!m_TriggerPattern.empty()) &&
+                   (std::search(l_Buffer.begin(), l_Buffer.end(), m_TriggerPattern.begin(), m_TriggerPattern.end()) != l_Buffer.end())) {
+            Trigger("pattern match");
+        } // else if
+    }
+
+    void OnCtrl(const HdlcdPacketCtrl& a_PacketCtrl) {
+        if (a_PacketCtrl.GetPacketType() != HdlcdPacketCtrl::CTRL_TYPE_PORT_STATUS) {
+            return;
+        } // if
+
+        bool l_bChanged = ((m_bHavePortStatus) && ((m_bAlive != a_PacketCtrl.GetIsAlive()) ||
+                                                   (m_bLockedBySelf != a_PacketCtrl.GetIsLockedBySelf()) ||
+                                                   (m_bLockedByOthers != a_PacketCtrl.GetIsLockedByOthers())));
+        m_bHavePortStatus = true;
+        m_bAlive = a_PacketCtrl.GetIsAlive();
+        m_bLockedBySelf = a_PacketCtrl.GetIsLockedBySelf();
+        m_bLockedByOthers = a_PacketCtrl.GetIsLockedByOthers();
+        if ((m_bTriggerOnStatusChange) && (l_bChanged)) {
+            Trigger("port status change");
+        } // if
+    }
+
+    // Hand a copy of the ring buffer to the dump thread. The frames are kept, thus a later dump also contains them.
+    void Trigger(const std::string& a_Reason) {
+        auto l_Now = std::chrono::steady_clock::now();
+        if ((m_NbrOfDumps) && ((l_Now - m_LastDump) < m_HoldOff)) {
+            // Suppress storms of triggers, e.g., caused by a series of broken frames
+            return;
+        } // if
+
+        if (m_FrameRingBuffer.GetNbrOfFrames() == 0) {
+            std::cerr << "Flight recorder: " << a_Reason << ", but no frames recorded" << std::endl;
+            return;
+        } // if
+
+        std::stringstream l_FileName;
+        l_FileName << m_FilePrefix << "." << boost::posix_time::to_iso_string(boost::posix_time::second_clock::universal_time())
+                   << "." << std::setw(4) << std::setfill('0') << m_NbrOfDumps << (m_bPcap ? ".pcap" : ".txt");
+        {
+            std::lock_guard<std::mutex> l_Lock(m_DumpMutex);
+            if (m_bDumpPending) {
+                std::cerr << "Flight recorder: " << a_Reason << ", but the previous dump is still being written" << std::endl;
+                return;
+            } // if
+
+            // Only copies bytes, the snapshot is not touched by the dump thread until it is signaled
+            m_FrameRingBuffer.CopyTo(m_Snapshot);
+            m_bDumpPending = true;
+            m_DumpReason = a_Reason;
+            m_DumpFileName = l_FileName.str();
+        }
+
+        m_DumpCondition.notify_one();
+        m_LastDump = l_Now;
+        ++m_NbrOfDumps;
+    }
+
+private:
+    // Helpers
+    void DumpLoop() {
+        std::unique_lock<std::mutex> l_Lock(m_DumpMutex);
+        while (true) {
+            m_DumpCondition.wait(l_Lock, [this](){ return (m_bDumpStopped || m_bDumpPending); });
+            if (m_bDumpPending) {
+                l_Lock.unlock();
+                Dump();
+                l_Lock.lock();
+                m_bDumpPending = false;
+            } // if
+
+            if (m_bDumpStopped) {
+                return;
+            } // if
+        } // while
+    }
+
+    void Dump() {
+        std::ofstream l_OutputFile(m_DumpFileName.c_str(), (m_bPcap ? (std::ios::out | std::ios::binary) : std::ios::out));
+        if (!l_OutputFile) {
+            std::cerr << "Flight recorder: " << m_DumpReason << ", but failed to create " << m_DumpFileName << std::endl;
+            return;
+        } // if
+
+        if (m_bPcap) {
+            WritePcapFileHeader(l_OutputFile, PCAP_LINKTYPE_HDLC);
+            m_Snapshot.ForEach([&l_OutputFile](const FrameRingBufferEntry& a_Entry) {
+                WritePcapRecord(l_OutputFile, a_Entry.m_Timestamp, a_Entry.m_Data, a_Entry.m_Length);
+            });
+        } else {
+            // Same format as "hdlcd-hexdump --timestamps", thus the dump can be processed by hdlcd-logconverter
+            m_Snapshot.ForEach([&l_OutputFile](const FrameRingBufferEntry& a_Entry) {
+                PrintFrameTimestamp(l_OutputFile, FrameTimestamp::FromMicroseconds(a_Entry.m_Timestamp));
+                HdlcdPacketDataPrinter(l_OutputFile, a_Entry.m_bWasSent, a_Entry.m_bInvalid,
+                                       std::vector<unsigned char>(a_Entry.m_Data, a_Entry.m_Data + a_Entry.m_Length));
+            });
+        } // else
+
+        std::cerr << "Flight recorder: " << m_DumpReason << ", wrote " << m_Snapshot.GetNbrOfFrames() << " frames to " << m_DumpFileName << std::endl;
+    }
+
+    // Members
+    FrameRingBuffer m_FrameRingBuffer;
+    std::string m_FilePrefix;
+    bool m_bPcap;
+    std::chrono::seconds m_HoldOff;
+    std::chrono::steady_clock::time_point m_LastDump;
+
+    // Triggers
+    std::vector<unsigned char> m_TriggerPattern;
+    bool m_bTriggerOnInvalid;
+    bool m_bTriggerOnStatusChange;
+    bool m_bHavePortStatus;
+    bool m_bAlive;
+    bool m_bLockedBySelf;
+    bool m_bLockedByOthers;
+    size_t m_NbrOfDumps;
+
+    // Shared with the dump thread
+    FrameRingBuffer m_Snapshot;
+    std::mutex m_DumpMutex;
+    std::condition_variable m_DumpCondition;
+    bool m_bDumpPending;
+    bool m_bDumpStopped;
+    std::string m_DumpReason;
+    std::string m_DumpFileName;
+    std::thread m_DumpThread;
+};
+
+#endif // FLIGHT_RECORDER_H
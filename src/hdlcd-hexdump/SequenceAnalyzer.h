@@ -0,0 +1,225 @@
+/**
+ * \file SequenceAnalyzer.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEQUENCE_ANALYZER_H
+#define SEQUENCE_ANALYZER_H
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdint>
+#include <chrono>
+#include <algorithm>
+#include "HdlcdClient.h"
+#include "HdlcSequenceTracker.h"
+
+class SequenceAnalyzer {
+public:
+    // CTOR
+    SequenceAnalyzer(std::ostream& a_OutputStream): m_OutputStream(a_OutputStream), m_NbrOfInvalids(0), m_Start(std::chrono::steady_clock::now()) {
+    }
+
+    void OnData(const HdlcdPacketData& a_PacketData) {
+        if (a_PacketData.GetInvalid()) {
+            ++m_NbrOfInvalids;
+            return;
+        } // if
+
+        // Frames are delivered unescaped as address, control, information, and FCS. The control field is modulo 8.
+        const std::vector<unsigned char>& l_Buffer = a_PacketData.GetData();
+        if (l_Buffer.size() < (HDLC_HEADER_SIZE + HDLC_FCS_SIZE)) {
+            return;
+        } // if
+
+        Direction& l_Direction = m_Directions[a_PacketData.GetWasSent() ? 1 : 0];
+        Direction& l_OppositeDirection = m_Directions[a_PacketData.GetWasSent() ? 0 : 1];
+        const char* l_Prefix = (a_PacketData.GetWasSent() ? "<<< Sent " : ">>> Rcvd ");
+        unsigned char l_Control = l_Buffer[1];
+        E_HDLC_FRAME_TYPE l_eFrameType = GetHdlcFrameType(l_Control);
+        if (l_eFrameType == HDLC_FRAME_TYPE_I) {
+            // I-frame: its N(R) acknowledges the frames of the opposite direction. An N(R) of frames not observed here is ignored,
+            // the next I-frame of the opposite direction reports the gap.
+            unsigned char l_Ns = GetHdlcNs(l_Control);
+            size_t l_InfoSize = (l_Buffer.size() - HDLC_HEADER_SIZE - HDLC_FCS_SIZE);
+            uint32_t l_Hash = Hash(l_Buffer.data() + HDLC_HEADER_SIZE, l_InfoSize);
+            ++l_Direction.m_IFrames;
+            l_OppositeDirection.m_Tracker.Acknowledge(GetHdlcNr(l_Control));
+            switch (l_Direction.Classify(l_Ns, l_Hash)) {
+            case FRAME_CLASS_DUPLICATE:
+                // Same N(S) and same information field as before: the peer did not get our acknowledgement
+                ++l_Direction.m_Retransmissions;
+                ++l_Direction.m_Duplicates;
+                m_OutputStream << l_Prefix << "retransmission N(S)=" << int(l_Ns) << ", " << l_InfoSize << " bytes, duplicate" << std::endl;
+                break;
+            case FRAME_CLASS_RETRANSMISSION:
+                // Go-back-N after a lost or broken frame: its content was not seen before, it counts once
+                ++l_Direction.m_Retransmissions;
+                l_Direction.m_Slots[l_Ns].m_bValid = true;
+                l_Direction.m_Slots[l_Ns].m_Hash = l_Hash;
+                l_Direction.m_GoodputBytes += l_InfoSize;
+                m_OutputStream << l_Prefix << "retransmission N(S)=" << int(l_Ns) << ", " << l_InfoSize << " bytes" << std::endl;
+                break;
+            case FRAME_CLASS_GAP:
+                m_OutputStream << l_Prefix << "gap: expected N(S)=" << int(l_Direction.m_Tracker.GetExpectedNs()) << ", got N(S)="
+                               << int(l_Ns) << ", " << ((l_Ns - l_Direction.m_Tracker.GetExpectedNs()) & 0x07) << " frames missing" << std::endl;
+                l_Direction.Accept(l_Ns, l_Hash);
+                l_Direction.m_GoodputBytes += l_InfoSize;
+                break;
+            default:
+                l_Direction.Accept(l_Ns, l_Hash);
+                l_Direction.m_GoodputBytes += l_InfoSize;
+                break;
+            } // switch
+        } else if (l_eFrameType == HDLC_FRAME_TYPE_S) {
+            // S-frame
+            unsigned char l_Nr = GetHdlcNr(l_Control);
+            l_OppositeDirection.m_Tracker.Acknowledge(l_Nr);
+            switch ((l_Control >> 2) & 0x03) {
+            case 0x02:
+                ++l_Direction.m_Rejects;
+                m_OutputStream << l_Prefix << "REJ N(R)=" << int(l_Nr) << std::endl;
+                break;
+            case 0x03:
+                ++l_Direction.m_SelectiveRejects;
+                m_OutputStream << l_Prefix << "SREJ N(R)=" << int(l_Nr) << std::endl;
+                break;
+            default:
+                break;
+            } // switch
+        } else if (l_eFrameType == HDLC_FRAME_TYPE_U) {
+            // U-frame: SABM, UA, DISC etc. reset the sequence numbers, UI-frames do not affect them
+            l_Direction.Reset();
+            l_OppositeDirection.Reset();
+        } // else if
+    }
+
+    void PrintStatistics() const {
+        double l_Seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - m_Start).count();
+        for (int l_Index = 1; l_Index >= 0; --l_Index) {
+            const Direction& l_Direction = m_Directions[l_Index];
+            double l_Ratio = (l_Direction.m_IFrames ? (100.0 * l_Direction.m_Retransmissions / l_Direction.m_IFrames) : 0.0);
+            double l_Goodput = ((l_Seconds > 0.0) ? (l_Direction.m_GoodputBytes / l_Seconds) : 0.0);
+            m_OutputStream << std::dec << (l_Index ? "Sent: " : "Rcvd: ") << l_Direction.m_IFrames << " I-frames, "
+                           << l_Direction.m_Retransmissions << " retransmissions (" << std::fixed << std::setprecision(2) << l_Ratio << "%, "
+                           << l_Direction.m_Duplicates << " duplicates), "
+                           << l_Direction.m_Gaps << " gaps with " << l_Direction.m_MissingFrames << " missing frames, "
+                           << l_Direction.m_Rejects << " REJ, " << l_Direction.m_SelectiveRejects << " SREJ, goodput "
+                           << std::setprecision(1) << l_Goodput << " bytes/s" << std::endl;
+        } // for
+
+        m_OutputStream << "Broken frames: " << m_NbrOfInvalids << std::endl;
+    }
+
+    // Bytes of information fields, each counted once regardless of retransmissions
+    uint64_t GetGoodputBytes(bool a_bWasSent) const {
+        return m_Directions[a_bWasSent ? 1 : 0].m_GoodputBytes;
+    }
+
+private:
+    // Helpers
+    static uint32_t Hash(const unsigned char* a_Data, size_t a_Length) {
+        // FNV-1a
+        uint32_t l_Hash = 2166136261u;
+        for (size_t l_Index = 0; l_Index < a_Length; ++l_Index) {
+            l_Hash = ((l_Hash ^ a_Data[l_Index]) * 16777619u);
+        } // for
+
+        return l_Hash;
+    }
+
+    // Types
+    typedef enum {
+        FRAME_CLASS_IN_SEQUENCE,
+        FRAME_CLASS_GAP,           // N(S) ahead of the expected one
+        FRAME_CLASS_RETRANSMISSION, // N(S) sent before but not yet acknowledged, with new content
+        FRAME_CLASS_DUPLICATE      // N(S) sent before but not yet acknowledged, with the same content
+    } E_FRAME_CLASS;
+
+    struct Slot {
+        bool m_bValid;
+        uint32_t m_Hash;
+    };
+
+    struct Direction {
+        Direction(): m_IFrames(0), m_Retransmissions(0), m_Duplicates(0), m_Gaps(0), m_MissingFrames(0), m_Rejects(0), m_SelectiveRejects(0),
+                     m_GoodputBytes(0) {
+            Reset();
+        }
+
+        void Reset() {
+            m_Tracker.Reset();
+            for (int l_Index = 0; l_Index < 8; ++l_Index) {
+                m_Slots[l_Index].m_bValid = false;
+                m_Slots[l_Index].m_Hash = 0;
+            } // for
+        }
+
+        // The window of frames that may be retransmitted are those sent but not yet acknowledged via N(R) by the peer
+        E_FRAME_CLASS Classify(unsigned char a_Ns, uint32_t a_Hash) const {
+            switch (m_Tracker.Check(a_Ns)) {
+            case HDLC_SEQUENCE_IN_SEQUENCE:
+                return FRAME_CLASS_IN_SEQUENCE;
+            case HDLC_SEQUENCE_REPEATED:
+                if ((m_Slots[a_Ns].m_bValid) && (m_Slots[a_Ns].m_Hash == a_Hash)) {
+                    return FRAME_CLASS_DUPLICATE;
+                } // if
+
+                return FRAME_CLASS_RETRANSMISSION;
+            default:
+                return FRAME_CLASS_GAP;
+            } // switch
+        }
+
+        // Take a new frame in sequence or after a gap
+        void Accept(unsigned char a_Ns, uint32_t a_Hash) {
+            unsigned int l_NbrOfMissing = m_Tracker.Advance(a_Ns);
+            if (l_NbrOfMissing) {
+                m_Gaps += 1;
+                m_MissingFrames += l_NbrOfMissing;
+            } // if
+
+            m_Slots[a_Ns].m_bValid = true;
+            m_Slots[a_Ns].m_Hash = a_Hash;
+        }
+
+        // Sequence state: one slot per N(S)
+        HdlcSequenceTracker m_Tracker;
+        Slot m_Slots[8];
+
+        // Statistics
+        size_t m_IFrames;
+        size_t m_Retransmissions;
+        size_t m_Duplicates;
+        size_t m_Gaps;
+        size_t m_MissingFrames;
+        size_t m_Rejects;
+        size_t m_SelectiveRejects;
+        uint64_t m_GoodputBytes;
+    };
+
+    // Members
+    std::ostream& m_OutputStream;
+    Direction m_Directions[2]; // 0: received, 1: sent
+    size_t m_NbrOfInvalids;
+    std::chrono::steady_clock::time_point m_Start;
+};
+
+#endif // SEQUENCE_ANALYZER_H
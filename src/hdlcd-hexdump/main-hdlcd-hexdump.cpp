@@ -21,11 +21,22 @@
 
 #include "Config.h"
 #include <iostream>
+#include <memory>
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
 #include <boost/regex.hpp>
 #include "HdlcdClient.h"
 #include "HdlcdPacketDataPrinter.h"
+#include "HdlcdSessionTraits.h"
+#include "FormattingPipeline.h"
+#include "StageProfiler.h"
+#include "FrameSampler.h"
+#include "MemoryPlacement.h"
+#include "OutputSink.h"
+#include "HexParser.h"
+#include "FlightRecorder.h"
+#include "SequenceAnalyzer.h"
+#include "StructuredPrinter.h"
 
 int main(int argc, char* argv[]) {
     try {
@@ -39,6 +50,46 @@ int main(int argc, char* argv[]) {
                           "syntax: SerialPort@IPAddess:PortNbr\n"
                           "  linux:   /dev/ttyUSB0@localhost:5001\n"
                           "  windows: //./COM1@example.com:5001")
+            ("threads,t", boost::program_options::value<unsigned int>()->default_value(0),
+                          "number of worker threads to format frames\n"
+                          "0: format on the network thread (default)")
+            ("output,o",  boost::program_options::value<std::string>(),
+                          "write to the specified file instead of STDOUT")
+            ("compress,z", "compress the output file (gzip)")
+            ("rotate-size", boost::program_options::value<unsigned int>()->default_value(0),
+                          "start a new output file after N MiB\n"
+                          "0: no size-based rotation (default)")
+            ("rotate-time", boost::program_options::value<unsigned int>()->default_value(0),
+                          "start a new output file after N seconds\n"
+                          "0: no time-based rotation (default)")
+            ("timestamps", "prefix each frame with its time of arrival (UTC)")
+            ("format",    boost::program_options::value<std::string>()->default_value("text"),
+                          "output format: text, json, or cbor")
+        ;
+
+        AddSamplingOptions(l_Description);
+        l_Description.add_options()
+            ("analyze,a", "track HDLC sequence numbers instead of printing frames:\n"
+                          "report retransmissions, gaps, REJ, and SREJ")
+            ("flight-recorder", boost::program_options::value<unsigned int>(),
+                          "keep the last N MiB of frames in memory instead of\n"
+                          "printing them, write them to a file on a trigger\n"
+                          "or on SIGUSR1")
+            ("recorder-output", boost::program_options::value<std::string>()->default_value("hdlcd-flightrecorder"),
+                          "file name prefix of flight recorder dumps")
+            ("recorder-format", boost::program_options::value<std::string>()->default_value("pcap"),
+                          "format of flight recorder dumps: pcap or text")
+            ("trigger-pattern", boost::program_options::value<std::string>(),
+                          "dump if a frame contains this byte sequence\n"
+                          "syntax: hex bytes, e.g., \"00 00 40 01\"")
+            ("trigger-broken", "dump if a frame with a broken CRC is received")
+            ("trigger-status", "dump if the port status changes")
+            ("trigger-holdoff", boost::program_options::value<unsigned int>()->default_value(5),
+                          "ignore triggers for N seconds after a dump")
+            ("numa",      boost::program_options::value<std::string>(),
+                          "place buffers and threads on a NUMA node, given as\n"
+                          "node number or as network interface, e.g., \"eth0\"")
+            ("hugepages", "allocate the flight recorder from huge pages")
         ;
 
         // Parse the command line
@@ -63,12 +114,50 @@ int main(int argc, char* argv[]) {
             return 1;
         } // if
 
+        bool l_bPcap = true;
+        if (l_VariablesMap.count("flight-recorder")) {
+            const std::string& l_RecorderFormat = l_VariablesMap["recorder-format"].as<std::string>();
+            if (l_RecorderFormat == "text") {
+                l_bPcap = false;
+            } else if (l_RecorderFormat != "pcap") {
+                std::cout << "hdlcd-hexdump: the recorder format must be \"pcap\" or \"text\"" << std::endl;
+                return 1;
+            } // else if
+
+            if (l_VariablesMap["flight-recorder"].as<unsigned int>() == 0) {
+                std::cout << "hdlcd-hexdump: the flight recorder needs at least 1 MiB" << std::endl;
+                return 1;
+            } // if
+        } // if
+
+        E_OUTPUT_FORMAT l_OutputFormat;
+        if (!ParseOutputFormat(l_VariablesMap["format"].as<std::string>(), l_OutputFormat)) {
+            std::cout << "hdlcd-hexdump: the output format must be \"text\", \"json\", or \"cbor\"" << std::endl;
+            return 1;
+        } // if
+
+        SamplingOptions l_SamplingOptions;
+        if (!ParseSamplingOptions(l_VariablesMap, l_SamplingOptions)) {
+            std::cout << "hdlcd-hexdump: the sampling must be \"every:N\", \"reservoir:N\", or \"rate:N\" with N > 0" << std::endl;
+            return 1;
+        } // if
+
+        // Must precede the creation of all threads, they inherit the CPU affinity
+        int l_NumaNode = -1;
+        if (l_VariablesMap.count("numa")) {
+            l_NumaNode = ParseNumaNode(l_VariablesMap["numa"].as<std::string>());
+            if (!BindThreadToNumaNode(l_NumaNode)) {
+                std::cerr << "hdlcd-hexdump: failed to bind to the CPUs of NUMA node " << l_NumaNode << std::endl;
+            } // if
+        } // if
+
         // Install signal handlers
         boost::asio::io_service l_IoService;
         boost::asio::signal_set l_Signals(l_IoService);
         l_Signals.add(SIGINT);
         l_Signals.add(SIGTERM);
         l_Signals.async_wait([&l_IoService](boost::system::error_code, int){ l_IoService.stop(); });
+        STAGE_PROFILER_DUMPER(l_IoService);
         
         // Parse the destination specifier
         static boost::regex s_RegEx("^(.*?)@(.*?):(.*?)$");
@@ -78,19 +167,150 @@ int main(int argc, char* argv[]) {
             boost::asio::ip::tcp::resolver l_Resolver(l_IoService);
             auto l_EndpointIterator = l_Resolver.resolve({ l_Match[2], l_Match[3] });
             
+            // Prepare the output sink. Writing to a file is done by a background thread.
+            std::unique_ptr<OutputSink> l_OutputSink;
+            if (l_VariablesMap.count("output")) {
+                l_OutputSink.reset(new OutputSink(l_VariablesMap["output"].as<std::string>(), l_VariablesMap.count("compress"),
+                                                  (uint64_t(l_VariablesMap["rotate-size"].as<unsigned int>()) * 1024 * 1024),
+                                                  std::chrono::seconds(l_VariablesMap["rotate-time"].as<unsigned int>())));
+            } // if
+
+            std::ostream& l_OutputStream = (l_OutputSink ? l_OutputSink->GetStream() : std::cout);
+
+            // Prepare the formatter of a single frame
+            typedef HdlcdSessionTraits<SESSION_TYPE_RX_HDLC, true, true> Session;
+            bool l_bTimestamps = l_VariablesMap.count("timestamps");
+            const StructuredPrinter l_StructuredPrinter(l_OutputFormat, l_Match[1].str());
+            auto l_PrintFrame = [l_OutputFormat, l_bTimestamps, &l_StructuredPrinter](std::ostream& a_OutputStream, bool a_bWasSent, bool a_bInvalid,
+                                                                                      const FrameTimestamp& a_FrameTimestamp, const std::vector<unsigned char>& a_Buffer) {
+                STAGE_PROFILER_SCOPE(PROFILER_STAGE_FORMAT);
+                if (l_OutputFormat != OUTPUT_FORMAT_TEXT) {
+                    l_StructuredPrinter.Print(a_OutputStream, a_bWasSent, a_bInvalid, a_FrameTimestamp, a_Buffer);
+                    return;
+                } // if
+
+                if (l_bTimestamps) {
+                    PrintFrameTimestamp(a_OutputStream, a_FrameTimestamp);
+                } // if
+
+                HdlcdPacketDataHexPrinter<Session>(a_OutputStream, a_bWasSent, a_bInvalid, a_Buffer);
+            };
+
+            // Prepare the optional formatting pipeline, decoupled from the network thread
+            std::unique_ptr<FormattingPipeline> l_FormattingPipeline;
+            if (l_VariablesMap["threads"].as<unsigned int>()) {
+                l_FormattingPipeline.reset(new FormattingPipeline(l_VariablesMap["threads"].as<unsigned int>(), [&l_PrintFrame](std::ostream& a_OutputStream, const FormattingPipelineEntry& a_Entry) {
+                    l_PrintFrame(a_OutputStream, a_Entry.m_bWasSent, a_Entry.m_bInvalid, a_Entry.m_Timestamp, a_Entry.m_Buffer);
+                }, l_OutputStream));
+            } // if
+
+            // Prepare the optional flight recorder, replacing the regular output
+            std::unique_ptr<FlightRecorder> l_FlightRecorder;
+            if (l_VariablesMap.count("flight-recorder")) {
+                l_FlightRecorder.reset(new FlightRecorder(size_t(l_VariablesMap["flight-recorder"].as<unsigned int>()) * 1024 * 1024,
+                                                          l_VariablesMap["recorder-output"].as<std::string>(), l_bPcap,
+                                                          std::chrono::seconds(l_VariablesMap["trigger-holdoff"].as<unsigned int>()),
+                                                          l_VariablesMap.count("hugepages"), l_NumaNode));
+                if (l_VariablesMap.count("trigger-pattern")) {
+                    const std::string& l_TriggerPattern = l_VariablesMap["trigger-pattern"].as<std::string>();
+                    HexParser l_HexParser(65535);
+                    l_HexParser.Parse(l_TriggerPattern.data(), l_TriggerPattern.data() + l_TriggerPattern.size());
+                    l_HexParser.Finish();
+                    if (l_HexParser.GetInvalid()) {
+                        std::cout << "hdlcd-hexdump: malformed trigger pattern at column " << l_HexParser.GetErrorColumn() << ": " << l_HexParser.GetError() << std::endl;
+                        return 1;
+                    } // if
+
+                    l_FlightRecorder->SetTriggerPattern(l_HexParser.GetPayload());
+                } // if
+
+                l_FlightRecorder->SetTriggerOnInvalid(l_VariablesMap.count("trigger-broken"));
+                l_FlightRecorder->SetTriggerOnStatusChange(l_VariablesMap.count("trigger-status"));
+            } // if
+
+#if defined(SIGUSR1)
+            // Manual trigger of the flight recorder
+            boost::asio::signal_set l_TriggerSignals(l_IoService);
+            std::function<void(boost::system::error_code, int)> l_OnTriggerSignal;
+            if (l_FlightRecorder) {
+                l_TriggerSignals.add(SIGUSR1);
+                l_OnTriggerSignal = [&l_FlightRecorder, &l_TriggerSignals, &l_OnTriggerSignal](boost::system::error_code a_ErrorCode, int) {
+                    if (!a_ErrorCode) {
+                        l_FlightRecorder->Trigger("SIGUSR1");
+                        l_TriggerSignals.async_wait(l_OnTriggerSignal);
+                    } // if
+                };
+
+                l_TriggerSignals.async_wait(l_OnTriggerSignal);
+            } // if
+#endif
+
+            // Prepare the optional sequence number analysis, replacing the regular output
+            std::unique_ptr<SequenceAnalyzer> l_SequenceAnalyzer;
+            if (l_VariablesMap.count("analyze")) {
+                l_SequenceAnalyzer.reset(new SequenceAnalyzer(l_OutputStream));
+            } // if
+
+            // Prepare the optional sampler: it decides before a frame is copied or formatted
+            auto l_OnFrame = [&l_FormattingPipeline, &l_OutputStream, &l_PrintFrame](bool a_bWasSent, bool a_bInvalid, const FrameTimestamp& a_FrameTimestamp,
+                                                                                     const std::vector<unsigned char>& a_Buffer) {
+                if (l_FormattingPipeline) {
+                    l_FormattingPipeline->Push(a_bWasSent, a_bInvalid, a_FrameTimestamp, a_Buffer);
+                } else {
+                    l_PrintFrame(l_OutputStream, a_bWasSent, a_bInvalid, a_FrameTimestamp, a_Buffer);
+                } // else
+            };
+
+            std::unique_ptr<FrameSampler> l_FrameSampler(CreateFrameSampler(l_IoService, l_SamplingOptions, l_OnFrame));
+
             // Prepare the HDLCd client entity
-            HdlcdClient l_HdlcdClient(l_IoService, l_Match[1], HdlcdSessionDescriptor(SESSION_TYPE_RX_HDLC, (SESSION_FLAGS_DELIVER_SENT | SESSION_FLAGS_DELIVER_RCVD)));
+            HdlcdClient l_HdlcdClient(l_IoService, l_Match[1], Session::CreateSessionDescriptor());
             l_HdlcdClient.SetOnClosedCallback([&l_IoService](){ l_IoService.stop(); });
-            l_HdlcdClient.SetOnDataCallback([](const HdlcdPacketData& a_PacketData){ HdlcdPacketDataPrinter(a_PacketData); });
-            l_HdlcdClient.AsyncConnect(l_EndpointIterator, [&l_Signals](bool a_bSuccess) {
+            l_HdlcdClient.SetOnDataCallback([&l_FlightRecorder, &l_SequenceAnalyzer, &l_FrameSampler, &l_OnFrame](const HdlcdPacketData& a_PacketData) {
+                STAGE_PROFILER_SCOPE(PROFILER_STAGE_RECEIVE);
+                FrameTimestamp l_FrameTimestamp(FrameTimestamp::Now());
+                if ((l_FlightRecorder) || (l_SequenceAnalyzer)) {
+                    if (l_FlightRecorder) {
+                        l_FlightRecorder->OnData(a_PacketData, l_FrameTimestamp);
+                    } // if
+
+                    if (l_SequenceAnalyzer) {
+                        l_SequenceAnalyzer->OnData(a_PacketData);
+                    } // if
+                } else if (l_FrameSampler) {
+                    l_FrameSampler->OnData(a_PacketData, l_FrameTimestamp);
+                } else {
+                    l_OnFrame(a_PacketData.GetWasSent(), a_PacketData.GetInvalid(), l_FrameTimestamp, a_PacketData.GetData());
+                } // else
+            });
+            if (l_FlightRecorder) {
+                l_HdlcdClient.SetOnCtrlCallback([&l_FlightRecorder](const HdlcdPacketCtrl& a_PacketCtrl) {
+                    l_FlightRecorder->OnCtrl(a_PacketCtrl);
+                });
+            } // if
+
+            l_HdlcdClient.AsyncConnect(l_EndpointIterator, [&](bool a_bSuccess) {
                 if (!a_bSuccess) {
                     std::cout << "Failed to connect to the HDLC Daemon!" << std::endl;
                     l_Signals.cancel();
+                    STAGE_PROFILER_CANCEL();
+#if defined(SIGUSR1)
+                    l_TriggerSignals.cancel();
+#endif
+                    if (l_FrameSampler) {
+                        l_FrameSampler->Cancel();
+                    } // if
                 } // if
             }); // AsyncConnect
 
             // Start event processing
             l_IoService.run();
+            if (l_FrameSampler) {
+                l_FrameSampler->Flush();
+            } // if
+            if (l_SequenceAnalyzer) {
+                l_SequenceAnalyzer->PrintStatistics();
+            } // if
         } else {
             throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value);
         } // else
@@ -0,0 +1,136 @@
+/**
+ * \file PayloadInjector.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAYLOAD_INJECTOR_H
+#define PAYLOAD_INJECTOR_H
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <boost/asio.hpp>
+#include <boost/asio/coroutine.hpp>
+#include "HdlcdAsyncSession.h"
+#include "HdlcdPacketDataPrinter.h"
+
+typedef struct {
+    std::vector<unsigned char> m_Payload;
+    size_t m_NbrOfPackets;
+    bool m_bLock;
+    bool m_bWaitForReply;
+    std::chrono::milliseconds m_Timeout;
+} PayloadInjectorParameters;
+
+// The sequence connect, lock, send, receive, unlock, shutdown as a stackless coroutine. Each copy of this object
+// is a completion handler resuming the sequence, thus all state is shared.
+class PayloadInjector: public boost::asio::coroutine {
+public:
+    // CTOR
+    PayloadInjector(HdlcdAsyncSession& a_HdlcdAsyncSession, boost::asio::ip::tcp::resolver::iterator a_EndpointIterator,
+                    const PayloadInjectorParameters& a_Parameters, std::function<void()> a_OnFinishedCallback):
+        m_State(std::make_shared<State>(a_HdlcdAsyncSession, a_EndpointIterator, a_Parameters, a_OnFinishedCallback)) {
+    }
+
+#include <boost/asio/yield.hpp>
+    void operator()(bool a_bSuccess = true) {
+        State& l_State = *m_State;
+        reenter (this) {
+            yield l_State.m_HdlcdAsyncSession.AsyncConnect(l_State.m_EndpointIterator, *this);
+            if (!a_bSuccess) {
+                std::cout << "Failed to connect to the HDLC Daemon!" << std::endl;
+                yield break;
+            } // if
+
+            if (l_State.m_Parameters.m_bLock) {
+                yield l_State.m_HdlcdAsyncSession.AsyncLock(true, l_State.m_Parameters.m_Timeout, *this);
+                if (!a_bSuccess) {
+                    std::cout << "Failed to lock the serial port!" << std::endl;
+                    yield break;
+                } // if
+            } // if
+
+            if (l_State.m_Parameters.m_bWaitForReply) {
+                // A reply must not be a packet that was received before the request
+                l_State.m_HdlcdAsyncSession.DiscardReceived();
+            } // if
+
+            // Pipeline all packets, only the completion of the last one is awaited
+            for (size_t l_Index = 1; l_Index < l_State.m_Parameters.m_NbrOfPackets; ++l_Index) {
+                l_State.m_HdlcdAsyncSession.AsyncSend(l_State.m_Parameters.m_Payload);
+            } // for
+
+            yield l_State.m_HdlcdAsyncSession.AsyncSend(l_State.m_Parameters.m_Payload, *this);
+            if (!a_bSuccess) {
+                std::cout << "Failed to send the payload!" << std::endl;
+                yield break;
+            } // if
+
+            if (l_State.m_Parameters.m_bWaitForReply) {
+                yield l_State.m_HdlcdAsyncSession.AsyncReceive(l_State.m_Reply, l_State.m_Parameters.m_Timeout, *this);
+                if (!a_bSuccess) {
+                    std::cout << "No reply received!" << std::endl;
+                    yield break;
+                } // if
+
+                HdlcdPacketDataHexPrinter<false, true>(std::cout, false, false, l_State.m_Reply);
+            } // if
+
+            if (l_State.m_Parameters.m_bLock) {
+                yield l_State.m_HdlcdAsyncSession.AsyncLock(false, l_State.m_Parameters.m_Timeout, *this);
+            } // if
+
+            yield l_State.m_HdlcdAsyncSession.AsyncShutdown(*this);
+        } // reenter
+
+        if (is_complete()) {
+            l_State.m_HdlcdAsyncSession.Close();
+            if (l_State.m_OnFinishedCallback) {
+                // Call only once, the state may be shared with outdated copies
+                std::function<void()> l_OnFinishedCallback;
+                l_OnFinishedCallback.swap(l_State.m_OnFinishedCallback);
+                l_OnFinishedCallback();
+            } // if
+        } // if
+    }
+#include <boost/asio/unyield.hpp>
+
+private:
+    // Types
+    struct State {
+        State(HdlcdAsyncSession& a_HdlcdAsyncSession, boost::asio::ip::tcp::resolver::iterator a_EndpointIterator,
+              const PayloadInjectorParameters& a_Parameters, std::function<void()> a_OnFinishedCallback):
+            m_HdlcdAsyncSession(a_HdlcdAsyncSession), m_EndpointIterator(a_EndpointIterator), m_Parameters(a_Parameters),
+            m_OnFinishedCallback(a_OnFinishedCallback) {
+        }
+
+        HdlcdAsyncSession& m_HdlcdAsyncSession;
+        boost::asio::ip::tcp::resolver::iterator m_EndpointIterator;
+        PayloadInjectorParameters m_Parameters;
+        std::function<void()> m_OnFinishedCallback;
+        std::vector<unsigned char> m_Reply;
+    };
+
+    // Members
+    std::shared_ptr<State> m_State;
+};
+
+#endif // PAYLOAD_INJECTOR_H
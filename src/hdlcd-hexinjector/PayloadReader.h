@@ -0,0 +1,100 @@
+/**
+ * \file PayloadReader.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAYLOAD_READER_H
+#define PAYLOAD_READER_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "HexParser.h"
+
+bool ReadPayload(const std::string& a_FileName, bool a_bBinary, size_t a_MaxPayloadSize, std::vector<unsigned char>& a_Payload) {
+    // Open the file, or use STDIN instead
+    std::ifstream l_File;
+    std::istream l_InputStream(std::cin.rdbuf());
+    size_t l_FileSize = 0;
+    if (a_FileName != "-") {
+        l_File.open(a_FileName.c_str(), std::ios::in | std::ios::binary);
+        if (!l_File) {
+            throw std::runtime_error("failed to open payload file " + a_FileName);
+        } // if
+
+        l_File.seekg(0, std::ios::end);
+        l_FileSize = l_File.tellg();
+        l_File.seekg(0, std::ios::beg);
+        l_InputStream.rdbuf(l_File.rdbuf());
+    } // if
+
+    a_Payload.clear();
+    if (a_bBinary) {
+        if (l_FileSize) {
+            // Size known: check it before reading anything, then read the file directly into the payload buffer
+            if (l_FileSize > a_MaxPayloadSize) {
+                return false;
+            } // if
+
+            a_Payload.resize(l_FileSize);
+            l_InputStream.read((char*)a_Payload.data(), l_FileSize);
+            a_Payload.resize(l_InputStream.gcount());
+        } else {
+            // Size unknown, e.g., STDIN: read chunk by chunk, but not beyond the limit
+            while (l_InputStream) {
+                size_t l_Offset = a_Payload.size();
+                a_Payload.resize(l_Offset + 65536);
+                l_InputStream.read((char*)a_Payload.data() + l_Offset, 65536);
+                a_Payload.resize(l_Offset + l_InputStream.gcount());
+                if (a_Payload.size() > a_MaxPayloadSize) {
+                    return false;
+                } // if
+            } // while
+        } // else
+    } else {
+        // Each byte takes at least two characters of the hex dump
+        HexParser l_HexParser(a_MaxPayloadSize);
+        l_HexParser.Reserve((l_FileSize / 2) + 1);
+        std::vector<char> l_Chunk(65536);
+        while (l_InputStream) {
+            l_InputStream.read(l_Chunk.data(), l_Chunk.size());
+            l_HexParser.Parse(l_Chunk.data(), l_Chunk.data() + l_InputStream.gcount());
+            if (l_HexParser.GetTooLarge()) {
+                return false;
+            } // if
+        } // while
+
+        l_HexParser.Finish();
+        if (l_HexParser.GetInvalid()) {
+            throw std::runtime_error("malformed hex dump in payload file " + a_FileName + ", " + l_HexParser.GetErrorText());
+        } // if
+
+        if (l_HexParser.GetTooLarge()) {
+            return false;
+        } // if
+
+        a_Payload = std::move(l_HexParser.GetPayload());
+    } // else
+
+    return true;
+}
+
+#endif // PAYLOAD_READER_H
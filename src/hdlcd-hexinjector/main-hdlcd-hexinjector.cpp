@@ -22,34 +22,15 @@
 #include "Config.h"
 #include <iostream>
 #include <vector>
-#include <list>
+#include <chrono>
+#include <algorithm>
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
 #include <boost/regex.hpp>
-#include "HdlcdClient.h"
-
-class SystemStopper {
-public:
-    // DTOR
-    ~SystemStopper() {
-        Stop();
-    }
-    
-    void RegisterStopperCallback(std::function<void()> a_StopperCallback) {
-        m_StopperCallbackList.push_back(a_StopperCallback);
-    }
-    
-    void Stop() {
-        while (!m_StopperCallbackList.empty()) {
-            auto l_StopperCallback = m_StopperCallbackList.front();
-            m_StopperCallbackList.pop_front();
-            l_StopperCallback();
-        } // while
-    }
-    
-private:
-    std::list<std::function<void()>> m_StopperCallbackList;
-};
+#include "HdlcdAsyncSession.h"
+#include "HexParser.h"
+#include "PayloadReader.h"
+#include "PayloadInjector.h"
 
 int main(int argc, char* argv[]) {
     try {
@@ -65,6 +46,18 @@ int main(int argc, char* argv[]) {
                           "  windows: //./COM1@example.com:5001")
             ("payload,p", boost::program_options::value<std::string>(),
                           "quoted payload to be sent as hex dump")
+            ("file,f",    boost::program_options::value<std::string>(),
+                          "read the payload from the specified file\n"
+                          "-: read from STDIN")
+            ("binary,b",  "the file contains raw binary payload instead of a hex dump")
+            ("max-size",  boost::program_options::value<size_t>()->default_value(65535),
+                          "maximum payload size in bytes")
+            ("count,n",   boost::program_options::value<size_t>()->default_value(1),
+                          "send the payload N times")
+            ("lock,l",    "lock the serial port during the transmission")
+            ("reply,r",   "wait for a reply and print it as hex dump")
+            ("timeout",   boost::program_options::value<unsigned int>()->default_value(1000),
+                          "timeout in ms for the lock and the reply")
         ;
 
         // Parse the command line
@@ -89,22 +82,42 @@ int main(int argc, char* argv[]) {
             return 1;
         } // if
         
-        if (!l_VariablesMap.count("payload")) {
+        if ((!l_VariablesMap.count("payload")) && (!l_VariablesMap.count("file"))) {
             std::cout << "hdlcd-hexinjector: you have to provide a payload to be transmitted" << std::endl;
             std::cout << "hdlcd-hexinjector: Use --help for more information." << std::endl;
             return 1;
         } // if
 
-        // Initialize main components
-        boost::asio::io_service l_IoService;
-        SystemStopper l_SystemStopper;
-        
+        // Obtain the payload before connecting to the HDLCd, reject it early if it is too large
+        std::vector<unsigned char> l_Payload;
+        bool l_bPayloadValid = false;
+        size_t l_MaxPayloadSize = l_VariablesMap["max-size"].as<size_t>();
+        if (l_VariablesMap.count("file")) {
+            l_bPayloadValid = ReadPayload(l_VariablesMap["file"].as<std::string>(), l_VariablesMap.count("binary"), l_MaxPayloadSize, l_Payload);
+        } else {
+            const std::string& l_HexDump = l_VariablesMap["payload"].as<std::string>();
+            HexParser l_HexParser(l_MaxPayloadSize);
+            l_HexParser.Parse(l_HexDump.data(), l_HexDump.data() + l_HexDump.size());
+            l_HexParser.Finish();
+            if (l_HexParser.GetInvalid()) {
+                std::cout << "hdlcd-hexinjector: malformed payload at column " << l_HexParser.GetErrorColumn() << ": " << l_HexParser.GetError() << std::endl;
+                return 1;
+            } // if
+
+            l_bPayloadValid = !l_HexParser.GetTooLarge();
+            l_Payload = std::move(l_HexParser.GetPayload());
+        } // else
+
+        if (!l_bPayloadValid) {
+            std::cout << "hdlcd-hexinjector: the payload exceeds the maximum size of " << l_MaxPayloadSize << " bytes" << std::endl;
+            return 1;
+        } // if
+
         // Install signal handlers
+        boost::asio::io_service l_IoService;
         boost::asio::signal_set l_Signals(l_IoService);
         l_Signals.add(SIGINT);
         l_Signals.add(SIGTERM);
-        l_Signals.async_wait([&l_SystemStopper](boost::system::error_code, int){ l_SystemStopper.Stop(); });
-        l_SystemStopper.RegisterStopperCallback([&l_Signals](){ l_Signals.cancel(); });
         
         // Parse the destination specifier
         static boost::regex s_RegEx("^(.*?)@(.*?):(.*?)$");
@@ -114,25 +127,24 @@ int main(int argc, char* argv[]) {
             boost::asio::ip::tcp::resolver l_Resolver(l_IoService);
             auto l_EndpointIterator = l_Resolver.resolve({ l_Match[2], l_Match[3] });
             
-            // Prepare the HDLCd client entity
-            HdlcdClient l_HdlcdClient(l_IoService, l_Match[1], HdlcdSessionDescriptor(SESSION_TYPE_TRX_ALL, SESSION_FLAGS_NONE));
-            l_HdlcdClient.SetOnClosedCallback([&l_SystemStopper](){ l_SystemStopper.Stop(); });
-            l_SystemStopper.RegisterStopperCallback([&l_HdlcdClient](){ l_HdlcdClient.Close(); });
-            l_HdlcdClient.AsyncConnect(l_EndpointIterator, [&l_VariablesMap, &l_HdlcdClient, &l_SystemStopper](bool a_bSuccess) {
-                if (a_bSuccess) {
-                    // Prepare input
-                    std::istringstream l_InputStream(l_VariablesMap["payload"].as<std::string>());
-                    l_InputStream >> std::hex;
-                    std::vector<unsigned char> l_Buffer;
-                    l_Buffer.reserve(65536);
-                    l_Buffer.insert(l_Buffer.end(),std::istream_iterator<unsigned int>(l_InputStream), {});
-                    l_HdlcdClient.Send(std::move(HdlcdPacketData::CreatePacket(l_Buffer, true)));
-                    l_HdlcdClient.Shutdown();
-                } else {
-                    std::cout << "Failed to connect to the HDLC Daemon!" << std::endl;
-                    l_SystemStopper.Stop();
-                } // else
-            }); // AsyncConnect
+            // Prepare the HDLCd session entity. Received payload is only delivered if a reply is expected.
+            PayloadInjectorParameters l_Parameters;
+            l_Parameters.m_Payload = std::move(l_Payload);
+            l_Parameters.m_NbrOfPackets = std::max<size_t>(1, l_VariablesMap["count"].as<size_t>());
+            l_Parameters.m_bLock = l_VariablesMap.count("lock");
+            l_Parameters.m_bWaitForReply = l_VariablesMap.count("reply");
+            l_Parameters.m_Timeout = std::chrono::milliseconds(l_VariablesMap["timeout"].as<unsigned int>());
+            HdlcdAsyncSession l_HdlcdAsyncSession(l_IoService, l_Match[1], HdlcdSessionDescriptor(SESSION_TYPE_TRX_ALL,
+                                                  (l_Parameters.m_bWaitForReply ? SESSION_FLAGS_DELIVER_RCVD : SESSION_FLAGS_NONE)));
+            l_Signals.async_wait([&l_HdlcdAsyncSession](boost::system::error_code a_ErrorCode, int) {
+                if (!a_ErrorCode) {
+                    l_HdlcdAsyncSession.Close();
+                } // if
+            });
+
+            // Run the sequence, it terminates with the connection
+            PayloadInjector l_PayloadInjector(l_HdlcdAsyncSession, l_EndpointIterator, l_Parameters, [&l_Signals](){ l_Signals.cancel(); });
+            l_PayloadInjector();
             
             // Start event processing
             l_IoService.run();
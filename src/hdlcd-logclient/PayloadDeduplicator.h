@@ -0,0 +1,164 @@
+/**
+ * \file PayloadDeduplicator.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAYLOAD_DEDUPLICATOR_H
+#define PAYLOAD_DEDUPLICATOR_H
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include "FrameTimestamp.h"
+#include "LogClientFormatter.h"
+#include "XxHash64.h"
+
+// Collapses repeated payloads: the first occurrence is logged, further occurrences within the window are only counted and reported
+// in a single summary line when the window ends. The summary lines do not start with a timestamp, thus hdlcd-logconverter skips them.
+class PayloadDeduplicator {
+public:
+    // CTOR: the recently logged payloads are kept in a small LRU with a_NbrOfSlots entries
+    PayloadDeduplicator(boost::asio::io_service& a_IoService, std::ostream& a_OutputStream, std::chrono::milliseconds a_Window, size_t a_NbrOfSlots):
+        m_OutputStream(a_OutputStream), m_Window(a_Window), m_Slots(std::max<size_t>(1, a_NbrOfSlots)), m_UseCounter(0), m_Timer(a_IoService),
+        m_bStopped(false), m_NbrOfPayloads(0), m_NbrOfSuppressed(0) {
+        StartTimer();
+    }
+
+    // Returns true if the payload has to be logged, false if it was a repetition
+    bool OnPayload(const std::vector<unsigned char>& a_Payload, const FrameTimestamp& a_FrameTimestamp) {
+        ++m_NbrOfPayloads;
+        uint64_t l_Hash = XxHash64(a_Payload.data(), a_Payload.size());
+        Slot* l_Target = &m_Slots[0];
+        for (auto l_Slot = m_Slots.begin(); l_Slot != m_Slots.end(); ++l_Slot) {
+            if ((l_Slot->m_bValid) && (l_Slot->m_Hash == l_Hash) && (l_Slot->m_Payload == a_Payload)) {
+                if ((a_FrameTimestamp.GetSteady() - l_Slot->m_First.GetSteady()) < m_Window) {
+                    // Repetition within the window: remember the time of the most recent one only
+                    l_Slot->m_Last = a_FrameTimestamp;
+                    ++(l_Slot->m_NbrOfRepetitions);
+                    l_Slot->m_LastUse = ++m_UseCounter;
+                    ++m_NbrOfSuppressed;
+                    return false;
+                } // if
+
+                // The window is over but not yet reported: start a new one in the same slot
+                l_Target = &(*l_Slot);
+                break;
+            } // if
+
+            if ((!l_Slot->m_bValid) || ((l_Target->m_bValid) && (l_Slot->m_LastUse < l_Target->m_LastUse))) {
+                // Least recently used so far
+                l_Target = &(*l_Slot);
+            } // if
+        } // for
+
+        // Not seen recently: reuse the slot, report its repetitions first to keep the order of the output
+        ReportAndRelease(*l_Target);
+        l_Target->m_bValid = true;
+        l_Target->m_Hash = l_Hash;
+        l_Target->m_Payload = a_Payload;
+        l_Target->m_First = a_FrameTimestamp;
+        l_Target->m_NbrOfRepetitions = 0;
+        l_Target->m_LastUse = ++m_UseCounter;
+        return true;
+    }
+
+    // Report all pending repetitions and stop the timer, e.g., on exit or if the connection failed
+    void Flush() {
+        m_bStopped = true;
+        m_Timer.cancel();
+        for (auto l_Slot = m_Slots.begin(); l_Slot != m_Slots.end(); ++l_Slot) {
+            ReportAndRelease(*l_Slot);
+        } // for
+    }
+
+    void PrintStatistics(std::ostream& a_OutputStream) const {
+        a_OutputStream << "Deduplication: " << m_NbrOfPayloads << " payloads, " << m_NbrOfSuppressed << " repetitions suppressed" << std::endl;
+    }
+
+private:
+    // Types
+    struct Slot {
+        Slot(): m_bValid(false), m_Hash(0), m_NbrOfRepetitions(0), m_LastUse(0) {
+        }
+
+        bool m_bValid;
+        uint64_t m_Hash;
+        std::vector<unsigned char> m_Payload;
+        FrameTimestamp m_First;
+        FrameTimestamp m_Last;
+        size_t m_NbrOfRepetitions;
+        uint64_t m_LastUse;
+    };
+
+    // Helpers
+    void ReportAndRelease(Slot& a_Slot) {
+        if ((a_Slot.m_bValid) && (a_Slot.m_NbrOfRepetitions)) {
+            // Example: Repeated 59 times until 19-02-2016;21:59:07.719;01 02 03
+            m_OutputStream << "Repeated " << a_Slot.m_NbrOfRepetitions << " times until ";
+            PrintLogTimestamp(m_OutputStream, a_Slot.m_Last.GetUtc());
+            m_OutputStream << ";";
+            HexBytesPrinter<true>(m_OutputStream, a_Slot.m_Payload);
+            m_OutputStream.put('\n');
+            m_OutputStream.flush();
+        } // if
+
+        a_Slot.m_bValid = false;
+        a_Slot.m_NbrOfRepetitions = 0;
+    }
+
+    void StartTimer() {
+        if (m_bStopped) {
+            return;
+        } // if
+
+        // Windows end at most half a window late
+        m_Timer.expires_from_now(std::max(std::chrono::milliseconds(1), (m_Window / 2)));
+        m_Timer.async_wait([this](const boost::system::error_code& a_ErrorCode) {
+            if (a_ErrorCode) {
+                return;
+            } // if
+
+            auto l_Now = std::chrono::steady_clock::now();
+            for (auto l_Slot = m_Slots.begin(); l_Slot != m_Slots.end(); ++l_Slot) {
+                if ((l_Slot->m_bValid) && ((l_Now - l_Slot->m_First.GetSteady()) >= m_Window)) {
+                    ReportAndRelease(*l_Slot);
+                } // if
+            } // for
+
+            StartTimer();
+        });
+    }
+
+    // Members
+    std::ostream& m_OutputStream;
+    std::chrono::milliseconds m_Window;
+    std::vector<Slot> m_Slots;
+    uint64_t m_UseCounter;
+    boost::asio::steady_timer m_Timer;
+    bool m_bStopped;
+
+    // Statistics
+    size_t m_NbrOfPayloads;
+    size_t m_NbrOfSuppressed;
+};
+
+#endif // PAYLOAD_DEDUPLICATOR_H
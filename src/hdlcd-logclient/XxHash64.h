@@ -0,0 +1,111 @@
+/**
+ * \file XxHash64.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XX_HASH_64_H
+#define XX_HASH_64_H
+
+#include <cstdint>
+#include <cstddef>
+
+// XXH64 by Yann Collet (BSD 2-clause), reimplemented after the specification. Produces the reference values, e.g., 0xEF46DB3751D8E999 for "".
+namespace XxHash64Detail {
+    static const uint64_t s_Prime1 = 0x9E3779B185EBCA87ULL;
+    static const uint64_t s_Prime2 = 0xC2B2AE3D27D4EB4FULL;
+    static const uint64_t s_Prime3 = 0x165667B19E3779F9ULL;
+    static const uint64_t s_Prime4 = 0x85EBCA77C2B2AE63ULL;
+    static const uint64_t s_Prime5 = 0x27D4EB2F165667C5ULL;
+
+    inline uint64_t RotateLeft(uint64_t a_Value, int a_Bits) {
+        return ((a_Value << a_Bits) | (a_Value >> (64 - a_Bits)));
+    }
+
+    // Little endian, independent of the host byte order and of alignment
+    inline uint64_t Read64(const unsigned char* a_Data) {
+        return (uint64_t(a_Data[0])       | (uint64_t(a_Data[1]) << 8)  | (uint64_t(a_Data[2]) << 16) | (uint64_t(a_Data[3]) << 24) |
+               (uint64_t(a_Data[4]) << 32) | (uint64_t(a_Data[5]) << 40) | (uint64_t(a_Data[6]) << 48) | (uint64_t(a_Data[7]) << 56));
+    }
+
+    inline uint64_t Read32(const unsigned char* a_Data) {
+        return (uint64_t(a_Data[0]) | (uint64_t(a_Data[1]) << 8) | (uint64_t(a_Data[2]) << 16) | (uint64_t(a_Data[3]) << 24));
+    }
+
+    inline uint64_t Round(uint64_t a_Accumulator, uint64_t a_Input) {
+        return (RotateLeft(a_Accumulator + (a_Input * s_Prime2), 31) * s_Prime1);
+    }
+
+    inline uint64_t MergeRound(uint64_t a_Accumulator, uint64_t a_Value) {
+        return (((a_Accumulator ^ Round(0, a_Value)) * s_Prime1) + s_Prime4);
+    }
+} // namespace XxHash64Detail
+
+uint64_t XxHash64(const void* a_Data, size_t a_Length, uint64_t a_Seed = 0) {
+    using namespace XxHash64Detail;
+    const unsigned char* l_Pos = (const unsigned char*)a_Data;
+    const unsigned char* l_End = (l_Pos + a_Length);
+    uint64_t l_Hash;
+    if (a_Length >= 32) {
+        // Four independent lanes of 8 bytes each
+        uint64_t l_Lane1 = (a_Seed + s_Prime1 + s_Prime2);
+        uint64_t l_Lane2 = (a_Seed + s_Prime2);
+        uint64_t l_Lane3 = a_Seed;
+        uint64_t l_Lane4 = (a_Seed - s_Prime1);
+        for (; (l_End - l_Pos) >= 32; l_Pos += 32) {
+            l_Lane1 = Round(l_Lane1, Read64(l_Pos));
+            l_Lane2 = Round(l_Lane2, Read64(l_Pos + 8));
+            l_Lane3 = Round(l_Lane3, Read64(l_Pos + 16));
+            l_Lane4 = Round(l_Lane4, Read64(l_Pos + 24));
+        } // for
+
+        l_Hash = (RotateLeft(l_Lane1, 1) + RotateLeft(l_Lane2, 7) + RotateLeft(l_Lane3, 12) + RotateLeft(l_Lane4, 18));
+        l_Hash = MergeRound(l_Hash, l_Lane1);
+        l_Hash = MergeRound(l_Hash, l_Lane2);
+        l_Hash = MergeRound(l_Hash, l_Lane3);
+        l_Hash = MergeRound(l_Hash, l_Lane4);
+    } else {
+        l_Hash = (a_Seed + s_Prime5);
+    } // else
+
+    l_Hash += a_Length;
+
+    // The remaining 0..31 bytes
+    for (; (l_End - l_Pos) >= 8; l_Pos += 8) {
+        l_Hash = ((RotateLeft(l_Hash ^ Round(0, Read64(l_Pos)), 27) * s_Prime1) + s_Prime4);
+    } // for
+
+    if ((l_End - l_Pos) >= 4) {
+        l_Hash = ((RotateLeft(l_Hash ^ (Read32(l_Pos) * s_Prime1), 23) * s_Prime2) + s_Prime3);
+        l_Pos += 4;
+    } // if
+
+    for (; l_Pos < l_End; ++l_Pos) {
+        l_Hash = (RotateLeft(l_Hash ^ (*l_Pos * s_Prime5), 11) * s_Prime1);
+    } // for
+
+    // Avalanche
+    l_Hash ^= (l_Hash >> 33);
+    l_Hash *= s_Prime2;
+    l_Hash ^= (l_Hash >> 29);
+    l_Hash *= s_Prime3;
+    l_Hash ^= (l_Hash >> 32);
+    return l_Hash;
+}
+
+#endif // XX_HASH_64_H
@@ -21,11 +21,18 @@
 
 #include "Config.h"
 #include <iostream>
+#include <memory>
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
 #include <boost/regex.hpp>
 #include "HdlcdClient.h"
 #include "LogClientFormatter.h"
+#include "FormattingPipeline.h"
+#include "StageProfiler.h"
+#include "MemoryPlacement.h"
+#include "StructuredPrinter.h"
+#include "OutputSink.h"
+#include "PayloadDeduplicator.h"
 
 int main(int argc, char* argv[]) {
     try {
@@ -39,6 +46,35 @@ int main(int argc, char* argv[]) {
                           "syntax: SerialPort@IPAddess:PortNbr\n"
                           "  linux:   /dev/ttyUSB0@localhost:5001\n"
                           "  windows: //./COM1@example.com:5001")
+            ("threads,t", boost::program_options::value<unsigned int>()->default_value(0),
+                          "number of worker threads to format frames\n"
+                          "0: format on the network thread (default)")
+            ("output,o",  boost::program_options::value<std::string>(),
+                          "write to the specified file instead of STDOUT")
+            ("compress,z", "compress the output file (gzip)")
+            ("rotate-size", boost::program_options::value<unsigned int>()->default_value(0),
+                          "start a new output file after N MiB\n"
+                          "0: no size-based rotation (default)")
+            ("rotate-time", boost::program_options::value<unsigned int>()->default_value(0),
+                          "start a new output file after N seconds\n"
+                          "0: no time-based rotation (default)")
+            ("retain-count", boost::program_options::value<unsigned int>()->default_value(0),
+                          "keep at most N rotated output files\n"
+                          "0: keep all files (default)")
+            ("retain-age", boost::program_options::value<unsigned int>()->default_value(0),
+                          "delete rotated output files older than N seconds\n"
+                          "0: keep all files (default)")
+            ("format",    boost::program_options::value<std::string>()->default_value("text"),
+                          "output format: text, json, or cbor")
+            ("numa",      boost::program_options::value<std::string>(),
+                          "place buffers and threads on a NUMA node, given as\n"
+                          "node number or as network interface, e.g., \"eth0\"")
+            ("dedup",     boost::program_options::value<unsigned int>()->default_value(0),
+                          "log repeated payloads once per window of N ms and\n"
+                          "report the number of repetitions (text format only)\n"
+                          "0: log all payloads (default)")
+            ("dedup-slots", boost::program_options::value<unsigned int>()->default_value(16),
+                          "number of distinct payloads tracked for --dedup")
         ;
 
         // Parse the command line
@@ -63,12 +99,34 @@ int main(int argc, char* argv[]) {
             return 1;
         } // if
 
+        E_OUTPUT_FORMAT l_OutputFormat;
+        if (!ParseOutputFormat(l_VariablesMap["format"].as<std::string>(), l_OutputFormat)) {
+            std::cout << "hdlcd-logclient: the output format must be \"text\", \"json\", or \"cbor\"" << std::endl;
+            return 1;
+        } // if
+
+        std::chrono::milliseconds l_DedupWindow(l_VariablesMap["dedup"].as<unsigned int>());
+        if ((l_DedupWindow.count()) && ((l_OutputFormat != OUTPUT_FORMAT_TEXT) || (l_VariablesMap["threads"].as<unsigned int>()))) {
+            std::cout << "hdlcd-logclient: --dedup requires the text format and formatting on the network thread" << std::endl;
+            return 1;
+        } // if
+
+        // Must precede the creation of all threads, they inherit the CPU affinity
+        int l_NumaNode = -1;
+        if (l_VariablesMap.count("numa")) {
+            l_NumaNode = ParseNumaNode(l_VariablesMap["numa"].as<std::string>());
+            if (!BindThreadToNumaNode(l_NumaNode)) {
+                std::cerr << "hdlcd-logclient: failed to bind to the CPUs of NUMA node " << l_NumaNode << std::endl;
+            } // if
+        } // if
+
         // Install signal handlers
         boost::asio::io_service l_IoService;
         boost::asio::signal_set l_Signals(l_IoService);
         l_Signals.add(SIGINT);
         l_Signals.add(SIGTERM);
         l_Signals.async_wait([&l_IoService](boost::system::error_code, int){ l_IoService.stop(); });
+        STAGE_PROFILER_DUMPER(l_IoService);
         
         // Parse the destination specifier
         static boost::regex s_RegEx("^(.*?)@(.*?):(.*?)$");
@@ -78,19 +136,77 @@ int main(int argc, char* argv[]) {
             boost::asio::ip::tcp::resolver l_Resolver(l_IoService);
             auto l_EndpointIterator = l_Resolver.resolve({ l_Match[2], l_Match[3] });
 
+            // Prepare the output sink. Writing to a file is done by a background thread.
+            std::unique_ptr<OutputSink> l_OutputSink;
+            if (l_VariablesMap.count("output")) {
+                l_OutputSink.reset(new OutputSink(l_VariablesMap["output"].as<std::string>(), l_VariablesMap.count("compress"),
+                                                  (uint64_t(l_VariablesMap["rotate-size"].as<unsigned int>()) * 1024 * 1024),
+                                                  std::chrono::seconds(l_VariablesMap["rotate-time"].as<unsigned int>())));
+                l_OutputSink->SetRetention(l_VariablesMap["retain-count"].as<unsigned int>(),
+                                           std::chrono::seconds(l_VariablesMap["retain-age"].as<unsigned int>()));
+            } // if
+
+            std::ostream& l_OutputStream = (l_OutputSink ? l_OutputSink->GetStream() : std::cout);
+
+            // Prepare the formatter of a single frame
+            const StructuredPrinter l_StructuredPrinter(l_OutputFormat, l_Match[1].str());
+            auto l_PrintFrame = [l_OutputFormat, &l_StructuredPrinter](std::ostream& a_OutputStream, bool a_bInvalid, const FrameTimestamp& a_FrameTimestamp,
+                                                                       const std::vector<unsigned char>& a_Buffer) {
+                STAGE_PROFILER_SCOPE(PROFILER_STAGE_FORMAT);
+                if (l_OutputFormat != OUTPUT_FORMAT_TEXT) {
+                    l_StructuredPrinter.Print(a_OutputStream, false, a_bInvalid, a_FrameTimestamp, a_Buffer);
+                } else {
+                    PrintLogEntry(a_OutputStream, a_FrameTimestamp.GetUtc(), a_Buffer);
+                } // else
+            };
+
+            // Prepare the optional formatting pipeline, decoupled from the network thread
+            std::unique_ptr<FormattingPipeline> l_FormattingPipeline;
+            if (l_VariablesMap["threads"].as<unsigned int>()) {
+                l_FormattingPipeline.reset(new FormattingPipeline(l_VariablesMap["threads"].as<unsigned int>(), [&l_PrintFrame](std::ostream& a_OutputStream, const FormattingPipelineEntry& a_Entry) {
+                    l_PrintFrame(a_OutputStream, a_Entry.m_bInvalid, a_Entry.m_Timestamp, a_Entry.m_Buffer);
+                }, l_OutputStream));
+            } // if
+
+            // Prepare the optional suppression of repeated payloads, it avoids the formatting of repetitions
+            std::unique_ptr<PayloadDeduplicator> l_PayloadDeduplicator;
+            if (l_DedupWindow.count()) {
+                l_PayloadDeduplicator.reset(new PayloadDeduplicator(l_IoService, l_OutputStream, l_DedupWindow, l_VariablesMap["dedup-slots"].as<unsigned int>()));
+            } // if
+
             // Prepare the HDLCd client entity
             HdlcdClient l_HdlcdClient(l_IoService, l_Match[1], HdlcdSessionDescriptor(SESSION_TYPE_RX_PAYLOAD, SESSION_FLAGS_DELIVER_RCVD));
             l_HdlcdClient.SetOnClosedCallback([&l_IoService](){ l_IoService.stop(); });
-            l_HdlcdClient.SetOnDataCallback([](const HdlcdPacketData& a_PacketData){ PrintLogEntry(a_PacketData.GetData()); });
-            l_HdlcdClient.AsyncConnect(l_EndpointIterator, [&l_Signals](bool a_bSuccess) {
+            l_HdlcdClient.SetOnDataCallback([&l_FormattingPipeline, &l_PayloadDeduplicator, &l_OutputStream, &l_PrintFrame](const HdlcdPacketData& a_PacketData) {
+                STAGE_PROFILER_SCOPE(PROFILER_STAGE_RECEIVE);
+                FrameTimestamp l_FrameTimestamp(FrameTimestamp::Now());
+                if ((l_PayloadDeduplicator) && (!a_PacketData.GetInvalid()) && (!l_PayloadDeduplicator->OnPayload(a_PacketData.GetData(), l_FrameTimestamp))) {
+                    return;
+                } // if
+
+                if (l_FormattingPipeline) {
+                    l_FormattingPipeline->Push(a_PacketData, l_FrameTimestamp);
+                } else {
+                    l_PrintFrame(l_OutputStream, a_PacketData.GetInvalid(), l_FrameTimestamp, a_PacketData.GetData());
+                } // else
+            });
+            l_HdlcdClient.AsyncConnect(l_EndpointIterator, [&](bool a_bSuccess) {
                 if (!a_bSuccess) {
                     std::cout << "Failed to connect to the HDLC Daemon!" << std::endl;
                     l_Signals.cancel();
+                    STAGE_PROFILER_CANCEL();
+                    if (l_PayloadDeduplicator) {
+                        l_PayloadDeduplicator->Flush();
+                    } // if
                 } // if
             }); // AsyncConnect
 
             // Start event processing
             l_IoService.run();
+            if (l_PayloadDeduplicator) {
+                l_PayloadDeduplicator->Flush();
+                l_PayloadDeduplicator->PrintStatistics(std::cerr);
+            } // if
         } else {
             throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value);
         } // else
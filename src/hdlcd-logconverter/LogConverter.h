@@ -0,0 +1,188 @@
+/**
+ * \file LogConverter.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOG_CONVERTER_H
+#define LOG_CONVERTER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "LogScanner.h"
+#include "PcapWriter.h"
+
+typedef enum {
+    CONVERTER_MODE_STATISTICS = 0, // Print a summary
+    CONVERTER_MODE_FILTER     = 1, // Copy all matching lines
+    CONVERTER_MODE_PCAP       = 2, // Write all matching frames as pcap file
+    CONVERTER_MODE_BINARY     = 3  // Write all matching frames, each preceded by its length (32 bit, network byte order)
+} E_CONVERTER_MODE;
+
+// Criteria a frame has to match, applied in all modes
+typedef struct {
+    bool m_bOnlySent;
+    bool m_bOnlyRcvd;
+    bool m_bOnlyInvalid;
+    std::vector<unsigned char> m_Pattern;
+} LogFilter;
+
+class LogStatistics {
+public:
+    // CTOR
+    LogStatistics(): m_NbrOfLines(0), m_NbrOfUnparsable(0), m_NbrOfRcvd(0), m_NbrOfSent(0), m_NbrOfInvalids(0), m_NbrOfBytes(0),
+        m_MinLength(std::numeric_limits<size_t>::max()), m_MaxLength(0), m_FirstTimestamp(std::numeric_limits<int64_t>::max()),
+        m_LastTimestamp(std::numeric_limits<int64_t>::min()) {
+    }
+
+    void AddLine(bool a_bParsable) {
+        ++m_NbrOfLines;
+        if (!a_bParsable) {
+            ++m_NbrOfUnparsable;
+        } // if
+    }
+
+    void AddFrame(const ScannedFrame& a_ScannedFrame, size_t a_Length) {
+        if (a_ScannedFrame.m_bWasSent) {
+            ++m_NbrOfSent;
+        } else {
+            ++m_NbrOfRcvd;
+        } // else
+
+        if (a_ScannedFrame.m_bInvalid) {
+            ++m_NbrOfInvalids;
+        } // if
+
+        m_NbrOfBytes += a_Length;
+        m_MinLength = std::min(m_MinLength, a_Length);
+        m_MaxLength = std::max(m_MaxLength, a_Length);
+        if (a_ScannedFrame.m_bHasTimestamp) {
+            m_FirstTimestamp = std::min(m_FirstTimestamp, a_ScannedFrame.m_Timestamp);
+            m_LastTimestamp = std::max(m_LastTimestamp, a_ScannedFrame.m_Timestamp);
+        } // if
+    }
+
+    void Merge(const LogStatistics& a_Other) {
+        m_NbrOfLines += a_Other.m_NbrOfLines;
+        m_NbrOfUnparsable += a_Other.m_NbrOfUnparsable;
+        m_NbrOfRcvd += a_Other.m_NbrOfRcvd;
+        m_NbrOfSent += a_Other.m_NbrOfSent;
+        m_NbrOfInvalids += a_Other.m_NbrOfInvalids;
+        m_NbrOfBytes += a_Other.m_NbrOfBytes;
+        m_MinLength = std::min(m_MinLength, a_Other.m_MinLength);
+        m_MaxLength = std::max(m_MaxLength, a_Other.m_MaxLength);
+        m_FirstTimestamp = std::min(m_FirstTimestamp, a_Other.m_FirstTimestamp);
+        m_LastTimestamp = std::max(m_LastTimestamp, a_Other.m_LastTimestamp);
+    }
+
+    void Print(std::ostream& a_OutputStream) const {
+        uint64_t l_NbrOfFrames = (m_NbrOfRcvd + m_NbrOfSent);
+        a_OutputStream << std::dec << "Lines:  " << m_NbrOfLines << ", unparsable " << m_NbrOfUnparsable << std::endl;
+        a_OutputStream << "Frames: " << l_NbrOfFrames << " (rcvd " << m_NbrOfRcvd << ", sent " << m_NbrOfSent << "), broken " << m_NbrOfInvalids << std::endl;
+        if (l_NbrOfFrames) {
+            a_OutputStream << "Bytes:  " << m_NbrOfBytes << ", frame length min " << m_MinLength << " / avg " << (m_NbrOfBytes / l_NbrOfFrames)
+                           << " / max " << m_MaxLength << std::endl;
+        } // if
+
+        if (m_FirstTimestamp <= m_LastTimestamp) {
+            static const boost::posix_time::ptime s_Epoch(boost::gregorian::date(1970, 1, 1));
+            double l_Seconds = ((m_LastTimestamp - m_FirstTimestamp) / 1000000.0);
+            a_OutputStream << "Time:   " << boost::posix_time::to_simple_string(s_Epoch + boost::posix_time::microseconds(m_FirstTimestamp)) << " to "
+                           << boost::posix_time::to_simple_string(s_Epoch + boost::posix_time::microseconds(m_LastTimestamp));
+            if (l_Seconds > 0.0) {
+                a_OutputStream << ", " << (l_NbrOfFrames / l_Seconds) << " frames/s, " << (m_NbrOfBytes / l_Seconds) << " bytes/s";
+            } // if
+
+            a_OutputStream << std::endl;
+        } // if
+    }
+
+private:
+    // Members
+    uint64_t m_NbrOfLines;
+    uint64_t m_NbrOfUnparsable;
+    uint64_t m_NbrOfRcvd;
+    uint64_t m_NbrOfSent;
+    uint64_t m_NbrOfInvalids;
+    uint64_t m_NbrOfBytes;
+    size_t m_MinLength;
+    size_t m_MaxLength;
+    int64_t m_FirstTimestamp;
+    int64_t m_LastTimestamp;
+};
+
+// Process a chunk of complete lines. Called concurrently for different chunks, all results are local.
+void ConvertChunk(const LogScanner& a_LogScanner, const LogFilter& a_LogFilter, E_CONVERTER_MODE a_ConverterMode,
+                  const char* a_Begin, const char* a_End, std::string& a_Output, LogStatistics& a_LogStatistics) {
+    ScannedFrame l_ScannedFrame;
+    std::vector<unsigned char> l_Payload;
+    l_Payload.reserve(4096);
+    for (const char* l_LineBegin = a_Begin; l_LineBegin < a_End; ) {
+        const char* l_LineEnd = (const char*)::memchr(l_LineBegin, '\n', a_End - l_LineBegin);
+        const char* l_NextLine = (l_LineEnd ? (l_LineEnd + 1) : a_End);
+        if (!l_LineEnd) {
+            l_LineEnd = a_End;
+        } // if
+
+        const char* l_ContentEnd = l_LineEnd;
+        if ((l_ContentEnd != l_LineBegin) && (*(l_ContentEnd - 1) == '\r')) {
+            --l_ContentEnd;
+        } // if
+
+        bool l_bParsable = a_LogScanner.ScanLine(l_LineBegin, l_ContentEnd, l_ScannedFrame, l_Payload);
+        a_LogStatistics.AddLine(l_bParsable);
+        if ((l_bParsable) &&
+            ((!a_LogFilter.m_bOnlySent) || (l_ScannedFrame.m_bWasSent)) &&
+            ((!a_LogFilter.m_bOnlyRcvd) || (!l_ScannedFrame.m_bWasSent)) &&
+            ((!a_LogFilter.m_bOnlyInvalid) || (l_ScannedFrame.m_bInvalid)) &&
+            ((a_LogFilter.m_Pattern.empty()) || (std::search(l_Payload.begin(), l_Payload.end(), a_LogFilter.m_Pattern.begin(), a_LogFilter.m_Pattern.end()) != l_Payload.end()))) {
+            a_LogStatistics.AddFrame(l_ScannedFrame, l_Payload.size());
+            switch (a_ConverterMode) {
+            case CONVERTER_MODE_FILTER:
+                a_Output.append(l_LineBegin, l_ContentEnd - l_LineBegin);
+                a_Output.push_back('\n');
+                break;
+            case CONVERTER_MODE_PCAP: {
+                char l_Header[16];
+                a_Output.append(l_Header, EncodePcapRecordHeader(l_Header, l_ScannedFrame.m_Timestamp, l_Payload.size()));
+                a_Output.append((const char*)l_Payload.data(), GetPcapCapturedLength(l_Payload.size()));
+                break;
+            }
+            case CONVERTER_MODE_BINARY: {
+                size_t l_Length = l_Payload.size();
+                char l_Header[4] = { char(l_Length >> 24), char(l_Length >> 16), char(l_Length >> 8), char(l_Length) };
+                a_Output.append(l_Header, sizeof(l_Header));
+                a_Output.append((const char*)l_Payload.data(), l_Payload.size());
+                break;
+            }
+            default:
+                break;
+            } // switch
+        } // if
+
+        l_LineBegin = l_NextLine;
+    } // for
+}
+
+#endif // LOG_CONVERTER_H
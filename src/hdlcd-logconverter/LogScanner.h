@@ -0,0 +1,204 @@
+/**
+ * \file LogScanner.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOG_SCANNER_H
+#define LOG_SCANNER_H
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+typedef enum {
+    LOG_FORMAT_LOGCLIENT = 0, // "19-02-2016;21:59:07.719;01 02 03 "
+    LOG_FORMAT_HEXDUMP   = 1  // ">>> Rcvd: 01 02 03 (CRC OK)", optionally preceded by "2016-02-19 21:59:07.719123 "
+} E_LOG_FORMAT;
+
+// One frame as found in a line of a log file
+typedef struct {
+    E_LOG_FORMAT m_LogFormat;
+    bool m_bWasSent;
+    bool m_bInvalid;
+    bool m_bHasTimestamp;
+    int64_t m_Timestamp; // Microseconds since the epoch, UTC
+} ScannedFrame;
+
+class LogScanner {
+public:
+    // CTOR
+    LogScanner() {
+        for (int l_Index = 0; l_Index < 256; ++l_Index) {
+            m_HexTable[l_Index] = -1;
+        } // for
+
+        for (int l_Index = 0; l_Index < 10; ++l_Index) {
+            m_HexTable['0' + l_Index] = l_Index;
+        } // for
+
+        for (int l_Index = 0; l_Index < 6; ++l_Index) {
+            m_HexTable['a' + l_Index] = (10 + l_Index);
+            m_HexTable['A' + l_Index] = (10 + l_Index);
+        } // for
+    }
+
+    // Parse one line without its line terminator. The payload buffer is reused to avoid allocations.
+    bool ScanLine(const char* a_Begin, const char* a_End, ScannedFrame& a_ScannedFrame, std::vector<unsigned char>& a_Payload) const {
+        a_Payload.clear();
+        a_ScannedFrame.m_bWasSent = false;
+        a_ScannedFrame.m_bInvalid = false;
+        a_ScannedFrame.m_bHasTimestamp = false;
+        a_ScannedFrame.m_Timestamp = 0;
+        const char* l_Pos = a_Begin;
+        if ((l_Pos != a_End) && (IsDigit(*l_Pos))) {
+            // Either a log entry of the logclient, or a timestamp of the hexdump tools
+            int l_First = 0;
+            l_Pos = ParseNumber(l_Pos, a_End, 4, l_First);
+            if ((l_Pos == a_End) || (*l_Pos != '-')) {
+                return false;
+            } // if
+
+            int l_Year, l_Month, l_Day;
+            char l_DateTimeSeparator;
+            if ((l_Pos - a_Begin) == 4) {
+                // "2016-02-19 21:59:07.719123 "
+                l_Year = l_First;
+                l_Pos = ParseNumber(l_Pos + 1, a_End, 2, l_Month);
+                if ((l_Pos == a_End) || (*l_Pos != '-')) {
+                    return false;
+                } // if
+
+                l_Pos = ParseNumber(l_Pos + 1, a_End, 2, l_Day);
+                l_DateTimeSeparator = ' ';
+                a_ScannedFrame.m_LogFormat = LOG_FORMAT_HEXDUMP;
+            } else {
+                // "19-02-2016;21:59:07.719;"
+                l_Day = l_First;
+                l_Pos = ParseNumber(l_Pos + 1, a_End, 2, l_Month);
+                if ((l_Pos == a_End) || (*l_Pos != '-')) {
+                    return false;
+                } // if
+
+                l_Pos = ParseNumber(l_Pos + 1, a_End, 4, l_Year);
+                l_DateTimeSeparator = ';';
+                a_ScannedFrame.m_LogFormat = LOG_FORMAT_LOGCLIENT;
+            } // else
+
+            int l_Hours, l_Minutes, l_Seconds, l_Fraction;
+            if ((l_Pos == a_End) || (*l_Pos != l_DateTimeSeparator)) {
+                return false;
+            } // if
+
+            l_Pos = ParseNumber(l_Pos + 1, a_End, 2, l_Hours);
+            if ((l_Pos == a_End) || (*l_Pos != ':')) {
+                return false;
+            } // if
+
+            l_Pos = ParseNumber(l_Pos + 1, a_End, 2, l_Minutes);
+            if ((l_Pos == a_End) || (*l_Pos != ':')) {
+                return false;
+            } // if
+
+            l_Pos = ParseNumber(l_Pos + 1, a_End, 2, l_Seconds);
+            if ((l_Pos == a_End) || (*l_Pos != '.')) {
+                return false;
+            } // if
+
+            const char* l_FractionBegin = (l_Pos + 1);
+            l_Pos = ParseNumber(l_FractionBegin, a_End, 6, l_Fraction);
+            for (const char* l_Digit = l_Pos; l_Digit < (l_FractionBegin + 6); ++l_Digit) {
+                // Milliseconds or microseconds
+                l_Fraction *= 10;
+            } // for
+
+            if ((l_Pos == a_End) || (*l_Pos != l_DateTimeSeparator)) {
+                return false;
+            } // if
+
+            a_ScannedFrame.m_bHasTimestamp = true;
+            a_ScannedFrame.m_Timestamp = ((((DaysFromCivil(l_Year, l_Month, l_Day) * 24 + l_Hours) * 60 + l_Minutes) * 60 + l_Seconds) * 1000000LL + l_Fraction);
+            ++l_Pos;
+            if (a_ScannedFrame.m_LogFormat == LOG_FORMAT_LOGCLIENT) {
+                // The logclient only records received payload
+                ParseHex(l_Pos, a_End, a_Payload);
+                return true;
+            } // if
+        } // if
+
+        // ">>> Rcvd: " or "<<< Sent: "
+        if (((a_End - l_Pos) < 10) || (::memcmp(l_Pos + 3, " Rcvd: ", 7) && ::memcmp(l_Pos + 3, " Sent: ", 7))) {
+            return false;
+        } // if
+
+        a_ScannedFrame.m_LogFormat = LOG_FORMAT_HEXDUMP;
+        a_ScannedFrame.m_bWasSent = (l_Pos[4] == 'S');
+        l_Pos = ParseHex(l_Pos + 10, a_End, a_Payload);
+        if (((a_End - l_Pos) >= 8) && (::memcmp(l_Pos, "(BROKEN)", 8) == 0)) {
+            a_ScannedFrame.m_bInvalid = true;
+        } // if
+
+        return true;
+    }
+
+private:
+    // Helpers
+    static bool IsDigit(char a_Char) {
+        return ((a_Char >= '0') && (a_Char <= '9'));
+    }
+
+    static const char* ParseNumber(const char* a_Pos, const char* a_End, int a_MaxDigits, int& a_Value) {
+        a_Value = 0;
+        for (int l_Digits = 0; (l_Digits < a_MaxDigits) && (a_Pos != a_End) && (IsDigit(*a_Pos)); ++l_Digits, ++a_Pos) {
+            a_Value = (a_Value * 10 + (*a_Pos - '0'));
+        } // for
+
+        return a_Pos;
+    }
+
+    const char* ParseHex(const char* a_Pos, const char* a_End, std::vector<unsigned char>& a_Payload) const {
+        // Tokens of two hex digits, each followed by a space
+        while (true) {
+            while ((a_Pos != a_End) && (*a_Pos == ' ')) {
+                ++a_Pos;
+            } // while
+
+            if (((a_End - a_Pos) < 2) || (m_HexTable[(unsigned char)a_Pos[0]] < 0) || (m_HexTable[(unsigned char)a_Pos[1]] < 0)) {
+                return a_Pos;
+            } // if
+
+            a_Payload.push_back((unsigned char)((m_HexTable[(unsigned char)a_Pos[0]] << 4) | m_HexTable[(unsigned char)a_Pos[1]]));
+            a_Pos += 2;
+        } // while
+    }
+
+    static int64_t DaysFromCivil(int a_Year, int a_Month, int a_Day) {
+        // Days since 1970-01-01 of the proleptic Gregorian calendar
+        a_Year -= (a_Month <= 2);
+        int64_t l_Era = ((a_Year >= 0) ? a_Year : (a_Year - 399)) / 400;
+        int64_t l_YearOfEra = (a_Year - l_Era * 400);
+        int64_t l_DayOfYear = ((153 * (a_Month + ((a_Month > 2) ? -3 : 9)) + 2) / 5 + a_Day - 1);
+        int64_t l_DayOfEra = (l_YearOfEra * 365 + l_YearOfEra / 4 - l_YearOfEra / 100 + l_DayOfYear);
+        return (l_Era * 146097 + l_DayOfEra - 719468);
+    }
+
+    // Members
+    signed char m_HexTable[256];
+};
+
+#endif // LOG_SCANNER_H
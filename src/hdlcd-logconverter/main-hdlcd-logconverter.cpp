@@ -0,0 +1,262 @@
+/**
+ * \file main-hdlcd-logconverter.cpp
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Config.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <boost/program_options.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "HexParser.h"
+#include "PcapWriter.h"
+#include "LogScanner.h"
+#include "LogConverter.h"
+
+// Determine the format of a log by looking at its first parsable line. Returns false if none was found.
+bool DetectLogFormat(const LogScanner& a_LogScanner, const std::string& a_FileName, E_LOG_FORMAT& a_eLogFormat) {
+    std::ifstream l_InputFile(a_FileName.c_str(), std::ios::in | std::ios::binary);
+    if (!l_InputFile) {
+        throw std::runtime_error("cannot open the input file " + a_FileName);
+    } // if
+
+    std::string l_Line;
+    ScannedFrame l_ScannedFrame;
+    std::vector<unsigned char> l_Payload;
+    for (int l_Lines = 0; (l_Lines < 100) && (std::getline(l_InputFile, l_Line)); ++l_Lines) {
+        if (a_LogScanner.ScanLine(l_Line.data(), l_Line.data() + l_Line.size(), l_ScannedFrame, l_Payload)) {
+            a_eLogFormat = l_ScannedFrame.m_LogFormat;
+            return true;
+        } // if
+    } // for
+
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        // Declare the supported options.
+        boost::program_options::options_description l_Description("Allowed options");
+        l_Description.add_options()
+            ("help,h",    "produce this help message")
+            ("version,v", "show version information")
+            ("input,i",   boost::program_options::value<std::vector<std::string>>()->composing(),
+                          "log file written by hdlcd-logclient, hdlcd-hexdump,\n"
+                          "or hdlcd-hexdump-payload, can be given multiple times")
+            ("output,o",  boost::program_options::value<std::string>(),
+                          "write to the specified file instead of STDOUT")
+            ("mode,m",    boost::program_options::value<std::string>()->default_value("stats"),
+                          "stats:  print a summary\n"
+                          "filter: print all matching lines\n"
+                          "pcap:   write matching frames as pcap file\n"
+                          "binary: write matching frames, each preceded\n"
+                          "        by its length (32 bit, big endian)")
+            ("linktype",  boost::program_options::value<std::string>()->default_value("auto"),
+                          "pcap link type: hdlc, payload, or auto\n"
+                          "auto: payload for logs of hdlcd-logclient")
+            ("pattern",   boost::program_options::value<std::string>(),
+                          "only frames containing this byte sequence\n"
+                          "syntax: hex bytes, e.g., \"00 00 40 01\"")
+            ("sent",      "only frames that were sent")
+            ("rcvd",      "only frames that were received")
+            ("broken",    "only frames with a broken CRC")
+            ("threads,t", boost::program_options::value<unsigned int>()->default_value(std::max(1u, std::thread::hardware_concurrency())),
+                          "number of threads to parse the input")
+        ;
+
+        // Parse the command line
+        boost::program_options::variables_map l_VariablesMap;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, l_Description), l_VariablesMap);
+        boost::program_options::notify(l_VariablesMap);
+        if (l_VariablesMap.count("version")) {
+            std::cerr << "HDLCd log converter version " << HDLCD_TOOLS_VERSION_MAJOR << "." << HDLCD_TOOLS_VERSION_MINOR << std::endl;
+        } // if
+
+        if (l_VariablesMap.count("help")) {
+            std::cout << l_Description << std::endl;
+            std::cout << "The HDLC log converter is Copyright (C) 2016, and GNU GPL'd, by Florian Evers." << std::endl;
+            std::cout << "Bug reports, feedback, admiration, abuse, etc, to: https://github.com/Strunzdesign/hdlcd-tools" << std::endl;
+            return 1;
+        } // if
+
+        if (!l_VariablesMap.count("input")) {
+            std::cout << "hdlcd-logconverter: you have to specify at least one input file" << std::endl;
+            std::cout << "hdlcd-logconverter: Use --help for more information." << std::endl;
+            return 1;
+        } // if
+
+        E_CONVERTER_MODE l_ConverterMode;
+        const std::string& l_Mode = l_VariablesMap["mode"].as<std::string>();
+        if (l_Mode == "stats") {
+            l_ConverterMode = CONVERTER_MODE_STATISTICS;
+        } else if (l_Mode == "filter") {
+            l_ConverterMode = CONVERTER_MODE_FILTER;
+        } else if (l_Mode == "pcap") {
+            l_ConverterMode = CONVERTER_MODE_PCAP;
+        } else if (l_Mode == "binary") {
+            l_ConverterMode = CONVERTER_MODE_BINARY;
+        } else {
+            std::cout << "hdlcd-logconverter: the mode must be \"stats\", \"filter\", \"pcap\", or \"binary\"" << std::endl;
+            return 1;
+        } // else
+
+        const std::string& l_LinkType = l_VariablesMap["linktype"].as<std::string>();
+        if ((l_LinkType != "auto") && (l_LinkType != "hdlc") && (l_LinkType != "payload")) {
+            std::cout << "hdlcd-logconverter: the link type must be \"hdlc\", \"payload\", or \"auto\"" << std::endl;
+            return 1;
+        } // if
+
+        LogFilter l_LogFilter;
+        l_LogFilter.m_bOnlySent = l_VariablesMap.count("sent");
+        l_LogFilter.m_bOnlyRcvd = l_VariablesMap.count("rcvd");
+        l_LogFilter.m_bOnlyInvalid = l_VariablesMap.count("broken");
+        if (l_VariablesMap.count("pattern")) {
+            const std::string& l_Pattern = l_VariablesMap["pattern"].as<std::string>();
+            HexParser l_HexParser(65535);
+            l_HexParser.Parse(l_Pattern.data(), l_Pattern.data() + l_Pattern.size());
+            l_HexParser.Finish();
+            if (l_HexParser.GetInvalid()) {
+                std::cout << "hdlcd-logconverter: malformed pattern at column " << l_HexParser.GetErrorColumn() << ": " << l_HexParser.GetError() << std::endl;
+                return 1;
+            } // if
+
+            l_LogFilter.m_Pattern = l_HexParser.GetPayload();
+        } // if
+
+        // Each input is checked in advance: logs of hdlcd-logclient contain payload only. The logs of hdlcd-hexdump and
+        // hdlcd-hexdump-payload share one format, thus it cannot be told whether they contain HDLC frames or payload.
+        const LogScanner l_LogScanner;
+        const std::vector<std::string>& l_InputFiles = l_VariablesMap["input"].as<std::vector<std::string>>();
+        uint32_t l_PcapLinkType = ((l_LinkType == "payload") ? PCAP_LINKTYPE_PAYLOAD : PCAP_LINKTYPE_HDLC);
+        if (l_ConverterMode == CONVERTER_MODE_PCAP) {
+            for (auto l_InputFile = l_InputFiles.begin(); l_InputFile != l_InputFiles.end(); ++l_InputFile) {
+                E_LOG_FORMAT l_eLogFormat;
+                if (!DetectLogFormat(l_LogScanner, *l_InputFile, l_eLogFormat)) {
+                    continue;
+                } // if
+
+                if (l_eLogFormat == LOG_FORMAT_LOGCLIENT) {
+                    if (l_LinkType == "hdlc") {
+                        std::cout << "hdlcd-logconverter: " << *l_InputFile << " was written by hdlcd-logclient and contains payload only" << std::endl;
+                        return 1;
+                    } // if
+
+                    l_PcapLinkType = PCAP_LINKTYPE_PAYLOAD;
+                } else if (l_LinkType == "auto") {
+                    std::cout << "hdlcd-logconverter: " << *l_InputFile << " may contain HDLC frames or payload, "
+                              << "the link type must be \"hdlc\" or \"payload\"" << std::endl;
+                    return 1;
+                } // else if
+            } // for
+        } // if
+
+        // Prepare the output
+        std::ofstream l_OutputFile;
+        if (l_VariablesMap.count("output")) {
+            l_OutputFile.open(l_VariablesMap["output"].as<std::string>().c_str(), std::ios::out | std::ios::binary);
+            if (!l_OutputFile) {
+                throw std::runtime_error("cannot create the output file");
+            } // if
+        } // if
+
+        std::ostream& l_OutputStream = (l_OutputFile.is_open() ? l_OutputFile : std::cout);
+
+        // Each round, every thread parses one chunk of complete lines. The results are written in order before the next round starts.
+        const size_t l_ChunkSize = (16 * 1024 * 1024);
+        const size_t l_NbrOfThreads = std::max(1u, l_VariablesMap["threads"].as<unsigned int>());
+        LogStatistics l_LogStatistics;
+        std::vector<std::string> l_Outputs(l_NbrOfThreads);
+        std::vector<LogStatistics> l_ChunkStatistics(l_NbrOfThreads);
+        uint64_t l_NbrOfInputBytes = 0;
+        bool l_bHeaderWritten = false;
+        auto l_Start = std::chrono::steady_clock::now();
+        for (auto l_InputFile = l_InputFiles.begin(); l_InputFile != l_InputFiles.end(); ++l_InputFile) {
+            std::ifstream l_SizeProbe(l_InputFile->c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+            if (!l_SizeProbe) {
+                throw std::runtime_error("cannot open the input file " + *l_InputFile);
+            } // if
+
+            size_t l_FileSize = l_SizeProbe.tellg();
+            l_SizeProbe.close();
+            if (l_FileSize == 0) {
+                continue;
+            } // if
+
+            boost::interprocess::file_mapping l_FileMapping(l_InputFile->c_str(), boost::interprocess::read_only);
+            boost::interprocess::mapped_region l_MappedRegion(l_FileMapping, boost::interprocess::read_only);
+            l_MappedRegion.advise(boost::interprocess::mapped_region::advice_sequential);
+            const char* l_Begin = (const char*)l_MappedRegion.get_address();
+            const char* l_End = (l_Begin + l_MappedRegion.get_size());
+            l_NbrOfInputBytes += l_MappedRegion.get_size();
+            if ((l_ConverterMode == CONVERTER_MODE_PCAP) && (!l_bHeaderWritten)) {
+                WritePcapFileHeader(l_OutputStream, l_PcapLinkType);
+                l_bHeaderWritten = true;
+            } // if
+
+            for (const char* l_RoundBegin = l_Begin; l_RoundBegin < l_End; ) {
+                // Split at line boundaries
+                std::vector<std::thread> l_Threads;
+                for (size_t l_Index = 0; (l_Index < l_NbrOfThreads) && (l_RoundBegin < l_End); ++l_Index) {
+                    const char* l_ChunkBegin = l_RoundBegin;
+                    const char* l_ChunkEnd = l_End;
+                    if ((size_t)(l_End - l_ChunkBegin) > l_ChunkSize) {
+                        const char* l_LineEnd = (const char*)::memchr(l_ChunkBegin + l_ChunkSize, '\n', l_End - (l_ChunkBegin + l_ChunkSize));
+                        if (l_LineEnd) {
+                            l_ChunkEnd = (l_LineEnd + 1);
+                        } // if
+                    } // if
+
+                    l_Outputs[l_Index].clear();
+                    l_ChunkStatistics[l_Index] = LogStatistics();
+                    l_Threads.emplace_back([&, l_Index, l_ChunkBegin, l_ChunkEnd]() {
+                        ConvertChunk(l_LogScanner, l_LogFilter, l_ConverterMode, l_ChunkBegin, l_ChunkEnd, l_Outputs[l_Index], l_ChunkStatistics[l_Index]);
+                    });
+
+                    l_RoundBegin = l_ChunkEnd;
+                } // for
+
+                for (size_t l_Index = 0; l_Index < l_Threads.size(); ++l_Index) {
+                    l_Threads[l_Index].join();
+                    l_OutputStream.write(l_Outputs[l_Index].data(), l_Outputs[l_Index].size());
+                    l_LogStatistics.Merge(l_ChunkStatistics[l_Index]);
+                } // for
+            } // for
+        } // for
+
+        l_OutputStream.flush();
+        if (l_ConverterMode == CONVERTER_MODE_STATISTICS) {
+            l_LogStatistics.Print(l_OutputStream);
+            double l_Seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - l_Start).count();
+            if (l_Seconds > 0.0) {
+                l_OutputStream << "Parsed " << (l_NbrOfInputBytes / (1024 * 1024)) << " MiB in " << l_Seconds << " s ("
+                               << (l_NbrOfInputBytes / l_Seconds / (1024 * 1024)) << " MiB/s)" << std::endl;
+            } // if
+        } // if
+    } catch (std::exception& a_Error) {
+        std::cerr << "Exception: " << a_Error.what() << "\n";
+    } // catch
+
+    return 0;
+}
@@ -0,0 +1,136 @@
+/**
+ * \file HdlcFrameDissector.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HDLC_FRAME_DISSECTOR_H
+#define HDLC_FRAME_DISSECTOR_H
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include "HdlcSequenceTracker.h"
+
+// Derive the payload locally, as delivered by RX_PAYLOAD sessions: the information field of UI-frames and of I-frames accepted in
+// sequence. Like a HDLC receiver, retransmitted and out-of-sequence I-frames are dropped. The N(R) of the opposite direction
+// resynchronizes the expected N(S) if frames were accepted by the peer that were not observed here.
+class HdlcPayloadExtractor {
+public:
+    // CTOR
+    HdlcPayloadExtractor() {
+    }
+
+    bool Extract(bool a_bWasSent, bool a_bInvalid, const std::vector<unsigned char>& a_Frame, std::vector<unsigned char>& a_Payload) {
+        if ((a_bInvalid) || (a_Frame.size() < (HDLC_HEADER_SIZE + HDLC_FCS_SIZE))) {
+            return false;
+        } // if
+
+        HdlcSequenceTracker& l_Tracker = m_Trackers[a_bWasSent ? 1 : 0];
+        HdlcSequenceTracker& l_OppositeTracker = m_Trackers[a_bWasSent ? 0 : 1];
+        unsigned char l_Control = a_Frame[1];
+        switch (GetHdlcFrameType(l_Control)) {
+        case HDLC_FRAME_TYPE_I:
+            Acknowledge(l_OppositeTracker, GetHdlcNr(l_Control));
+            if (l_Tracker.Check(GetHdlcNs(l_Control)) != HDLC_SEQUENCE_IN_SEQUENCE) {
+                return false;
+            } // if
+
+            l_Tracker.Advance(GetHdlcNs(l_Control));
+            break;
+        case HDLC_FRAME_TYPE_S:
+            Acknowledge(l_OppositeTracker, GetHdlcNr(l_Control));
+            return false;
+        case HDLC_FRAME_TYPE_U:
+            l_Tracker.Reset();
+            l_OppositeTracker.Reset();
+            return false;
+        default:
+            // UI-frame: always delivered
+            break;
+        } // switch
+
+        a_Payload.assign(a_Frame.begin() + HDLC_HEADER_SIZE, a_Frame.end() - HDLC_FCS_SIZE);
+        return true;
+    }
+
+private:
+    // Helpers
+    static void Acknowledge(HdlcSequenceTracker& a_Tracker, unsigned char a_Nr) {
+        if (!a_Tracker.Acknowledge(a_Nr)) {
+            // The peer accepted frames that were not observed: continue with the frame it expects
+            a_Tracker.Resynchronize(a_Nr);
+        } // if
+    }
+
+    // Members
+    HdlcSequenceTracker m_Trackers[2]; // 0: received, 1: sent
+};
+
+// Print a one-line summary of the header of a HDLC frame
+void PrintHdlcFrameDissection(std::ostream& a_OutputStream, bool a_bWasSent, bool a_bInvalid, const std::vector<unsigned char>& a_Frame) {
+    a_OutputStream << (a_bWasSent ? "<<< Sent " : ">>> Rcvd ");
+    if (a_Frame.size() < (HDLC_HEADER_SIZE + HDLC_FCS_SIZE)) {
+        a_OutputStream << "malformed frame, " << a_Frame.size() << " bytes" << std::endl;
+        return;
+    } // if
+
+    unsigned char l_Control = a_Frame[1];
+    bool l_bPollFinal = (l_Control & 0x10);
+    a_OutputStream << "Addr=0x" << std::hex << std::setw(2) << std::setfill('0') << int(a_Frame[0]) << std::dec << " ";
+    E_HDLC_FRAME_TYPE l_eFrameType = GetHdlcFrameType(l_Control);
+    if (l_eFrameType == HDLC_FRAME_TYPE_I) {
+        a_OutputStream << "I-frame N(S)=" << int(GetHdlcNs(l_Control)) << " N(R)=" << int(GetHdlcNr(l_Control));
+    } else if (l_eFrameType == HDLC_FRAME_TYPE_S) {
+        static const char* s_SFrameTypes[] = { "RR", "RNR", "REJ", "SREJ" };
+        a_OutputStream << s_SFrameTypes[(l_Control >> 2) & 0x03] << " N(R)=" << int(GetHdlcNr(l_Control));
+    } else {
+        switch (l_Control & 0xEF) {
+        case 0x03: a_OutputStream << "UI";    break;
+        case 0x0F: a_OutputStream << "DM";    break;
+        case 0x2F: a_OutputStream << "SABM";  break;
+        case 0x43: a_OutputStream << "DISC";  break;
+        case 0x63: a_OutputStream << "UA";    break;
+        case 0x83: a_OutputStream << "SNRM";  break;
+        case 0x87: a_OutputStream << "FRMR";  break;
+        case 0xAF: a_OutputStream << "XID";   break;
+        case 0xE3: a_OutputStream << "TEST";  break;
+        default:
+            a_OutputStream << "U-frame 0x" << std::hex << std::setw(2) << std::setfill('0') << int(l_Control) << std::dec;
+            break;
+        } // switch
+    } // else
+
+    if (l_bPollFinal) {
+        a_OutputStream << " P/F";
+    } // if
+
+    size_t l_InfoSize = (a_Frame.size() - HDLC_HEADER_SIZE - HDLC_FCS_SIZE);
+    if (l_InfoSize) {
+        a_OutputStream << ", " << l_InfoSize << " bytes";
+    } // if
+
+    if (a_bInvalid) {
+        a_OutputStream << " (CRC error)";
+    } // if
+
+    a_OutputStream << std::endl;
+}
+
+#endif // HDLC_FRAME_DISSECTOR_H
@@ -0,0 +1,200 @@
+/**
+ * \file main-hdlcd-observer.cpp
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Config.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+#include <boost/regex.hpp>
+#include "HdlcdClient.h"
+#include "HdlcdPacketDataPrinter.h"
+#include "HdlcdPacketCtrlPrinter.h"
+#include "HdlcdSessionTraits.h"
+#include "FrameTimestamp.h"
+#include "OutputSink.h"
+#include "HdlcFrameDissector.h"
+
+int main(int argc, char* argv[]) {
+    try {
+        // Declare the supported options.
+        boost::program_options::options_description l_Description("Allowed options");
+        l_Description.add_options()
+            ("help,h",    "produce this help message")
+            ("version,v", "show version information")
+            ("connect,c", boost::program_options::value<std::string>(),
+                          "connect to a single device via the HDLCd\n"
+                          "syntax: SerialPort@IPAddess:PortNbr\n"
+                          "  linux:   /dev/ttyUSB0@localhost:5001\n"
+                          "  windows: //./COM1@example.com:5001")
+            ("hdlc",      boost::program_options::value<std::string>(),
+                          "write a hex dump of all HDLC frames to this file\n"
+                          "(\"-\": STDOUT), as hdlcd-hexdump")
+            ("payload",   boost::program_options::value<std::string>(),
+                          "write a hex dump of the payload of UI-frames and of\n"
+                          "I-frames in sequence to this file (\"-\": STDOUT)")
+            ("dissect",   boost::program_options::value<std::string>(),
+                          "write a summary of each HDLC frame to this file\n"
+                          "(\"-\": STDOUT)")
+            ("status",    boost::program_options::value<std::string>(),
+                          "write all port status changes to this file\n"
+                          "(\"-\": STDOUT), as hdlcd-monitor")
+            ("timestamps", "prefix each frame with its time of arrival (UTC)")
+        ;
+
+        // Parse the command line
+        boost::program_options::variables_map l_VariablesMap;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, l_Description), l_VariablesMap);
+        boost::program_options::notify(l_VariablesMap);
+        if (l_VariablesMap.count("version")) {
+            std::cerr << "HDLCd observer version " << HDLCD_TOOLS_VERSION_MAJOR << "." << HDLCD_TOOLS_VERSION_MINOR
+                      << " built with hdlcd-devel version " << HDLCD_DEVEL_VERSION_MAJOR << "." << HDLCD_DEVEL_VERSION_MINOR << std::endl;
+        } // if
+
+        if (l_VariablesMap.count("help")) {
+            std::cout << l_Description << std::endl;
+            std::cout << "The HDLCd observer is Copyright (C) 2016, and GNU GPL'd, by Florian Evers." << std::endl;
+            std::cout << "Bug reports, feedback, admiration, abuse, etc, to: https://github.com/Strunzdesign/hdlcd-tools" << std::endl;
+            return 1;
+        } // if
+        
+        if (!l_VariablesMap.count("connect")) {
+            std::cout << "hdlcd-observer: you have to specify one device to connect to" << std::endl;
+            std::cout << "hdlcd-observer: Use --help for more information." << std::endl;
+            return 1;
+        } // if
+
+        if ((!l_VariablesMap.count("hdlc")) && (!l_VariablesMap.count("payload")) && (!l_VariablesMap.count("dissect")) && (!l_VariablesMap.count("status"))) {
+            std::cout << "hdlcd-observer: you have to specify at least one of --hdlc, --payload, --dissect, or --status" << std::endl;
+            return 1;
+        } // if
+
+        // Prepare the output sinks. Views written to the same file share a sink, each file is written by a background thread.
+        std::map<std::string, std::unique_ptr<OutputSink>> l_OutputSinks;
+        auto l_GetStream = [&l_VariablesMap, &l_OutputSinks](const char* a_View) -> std::ostream* {
+            if (!l_VariablesMap.count(a_View)) {
+                return NULL;
+            } // if
+
+            const std::string& l_FileName = l_VariablesMap[a_View].as<std::string>();
+            if (l_FileName == "-") {
+                return &std::cout;
+            } // if
+
+            std::unique_ptr<OutputSink>& l_OutputSink = l_OutputSinks[l_FileName];
+            if (!l_OutputSink) {
+                l_OutputSink.reset(new OutputSink(l_FileName, false));
+            } // if
+
+            return &l_OutputSink->GetStream();
+        };
+
+        std::ostream* l_HdlcStream    = l_GetStream("hdlc");
+        std::ostream* l_PayloadStream = l_GetStream("payload");
+        std::ostream* l_DissectStream = l_GetStream("dissect");
+        std::ostream* l_StatusStream  = l_GetStream("status");
+
+        // Install signal handlers
+        boost::asio::io_service l_IoService;
+        boost::asio::signal_set l_Signals(l_IoService);
+        l_Signals.add(SIGINT);
+        l_Signals.add(SIGTERM);
+        l_Signals.async_wait([&l_IoService](boost::system::error_code, int){ l_IoService.stop(); });
+        
+        // Parse the destination specifier
+        static boost::regex s_RegEx("^(.*?)@(.*?):(.*?)$");
+        boost::smatch l_Match;
+        if (boost::regex_match(l_VariablesMap["connect"].as<std::string>(), l_Match, s_RegEx)) {
+            // Resolve destination
+            boost::asio::ip::tcp::resolver l_Resolver(l_IoService);
+            auto l_EndpointIterator = l_Resolver.resolve({ l_Match[2], l_Match[3] });
+
+            // A single RX_HDLC session carries everything: the payload and the dissection are derived locally, the port status
+            // is delivered to each session. Thus, the HDLCd has to copy each frame only once for all views. If only the port status
+            // is of interest, no frames are requested at all.
+            typedef HdlcdSessionTraits<SESSION_TYPE_RX_HDLC,    true, true> Session;
+            typedef HdlcdSessionTraits<SESSION_TYPE_RX_PAYLOAD, true, true> PayloadSession;
+            bool l_bFrames = ((l_HdlcStream) || (l_PayloadStream) || (l_DissectStream));
+            bool l_bTimestamps = l_VariablesMap.count("timestamps");
+            HdlcPayloadExtractor l_HdlcPayloadExtractor;
+            std::vector<unsigned char> l_Payload;
+
+            // Prepare the HDLCd client entity
+            HdlcdClient l_HdlcdClient(l_IoService, l_Match[1], (l_bFrames ? Session::CreateSessionDescriptor() :
+                                                                            HdlcdSessionDescriptor(SESSION_TYPE_TRX_STATUS, SESSION_FLAGS_NONE)));
+            l_HdlcdClient.SetOnClosedCallback([&l_IoService](){ l_IoService.stop(); });
+            if (l_bFrames) {
+                l_HdlcdClient.SetOnDataCallback([=, &l_HdlcPayloadExtractor, &l_Payload](const HdlcdPacketData& a_PacketData) {
+                    FrameTimestamp l_FrameTimestamp(FrameTimestamp::Now());
+                    const std::vector<unsigned char>& l_Buffer = a_PacketData.GetData();
+                    if (l_HdlcStream) {
+                        if (l_bTimestamps) {
+                            PrintFrameTimestamp(*l_HdlcStream, l_FrameTimestamp);
+                        } // if
+
+                        HdlcdPacketDataHexPrinter<Session>(*l_HdlcStream, a_PacketData.GetWasSent(), a_PacketData.GetInvalid(), l_Buffer);
+                    } // if
+
+                    if (l_DissectStream) {
+                        if (l_bTimestamps) {
+                            PrintFrameTimestamp(*l_DissectStream, l_FrameTimestamp);
+                        } // if
+
+                        PrintHdlcFrameDissection(*l_DissectStream, a_PacketData.GetWasSent(), a_PacketData.GetInvalid(), l_Buffer);
+                    } // if
+
+                    if ((l_PayloadStream) && (l_HdlcPayloadExtractor.Extract(a_PacketData.GetWasSent(), a_PacketData.GetInvalid(), l_Buffer, l_Payload))) {
+                        if (l_bTimestamps) {
+                            PrintFrameTimestamp(*l_PayloadStream, l_FrameTimestamp);
+                        } // if
+
+                        HdlcdPacketDataHexPrinter<PayloadSession>(*l_PayloadStream, a_PacketData.GetWasSent(), false, l_Payload);
+                    } // if
+                });
+            } // if
+
+            if (l_StatusStream) {
+                l_HdlcdClient.SetOnCtrlCallback([l_StatusStream](const HdlcdPacketCtrl& a_PacketCtrl) {
+                    HdlcdPacketCtrlPrinter(*l_StatusStream, a_PacketCtrl);
+                });
+            } // if
+
+            l_HdlcdClient.AsyncConnect(l_EndpointIterator, [&l_Signals](bool a_bSuccess) {
+                if (!a_bSuccess) {
+                    std::cout << "Failed to connect to the HDLC Daemon!" << std::endl;
+                    l_Signals.cancel();
+                } // if
+            }); // AsyncConnect
+
+            // Start event processing
+            l_IoService.run();
+        } else {
+            throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value);
+        } // else
+    } catch (std::exception& a_Error) {
+        std::cerr << "Exception: " << a_Error.what() << "\n";
+    } // catch
+
+    return 0;
+}
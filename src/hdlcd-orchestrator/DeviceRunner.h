@@ -0,0 +1,263 @@
+/**
+ * \file DeviceRunner.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DEVICE_RUNNER_H
+#define DEVICE_RUNNER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/regex.hpp>
+#include "HdlcdClient.h"
+#include "Scenario.h"
+
+// The outcome of one step of a device script
+typedef struct {
+    const ScenarioStep* m_ScenarioStep; // NULL: connect
+    bool m_bSuccess;
+    std::chrono::steady_clock::duration m_Latency;
+    std::string m_Error;
+} StepResult;
+
+class DeviceRunner {
+public:
+    // CTOR: all handlers of this device are executed by the provided io_service, i.e., by one thread of the pool
+    DeviceRunner(boost::asio::io_service& a_IoService, const DeviceScenario& a_DeviceScenario, std::chrono::milliseconds a_DefaultTimeout,
+                 std::function<void()> a_OnFinishedCallback): m_IoService(a_IoService), m_DeviceScenario(a_DeviceScenario),
+                 m_DefaultTimeout(a_DefaultTimeout), m_OnFinishedCallback(a_OnFinishedCallback), m_Timer(a_IoService), m_StepIndex(0),
+                 m_bConnected(false), m_bFinished(false), m_bSuccess(false) {
+    }
+
+    void Start() {
+        static boost::regex s_RegEx("^(.*?)@(.*?):(.*?)$");
+        boost::smatch l_Match;
+        if (!boost::regex_match(m_DeviceScenario.m_Device, l_Match, s_RegEx)) {
+            throw std::runtime_error("invalid device specifier " + m_DeviceScenario.m_Device);
+        } // if
+
+        boost::asio::ip::tcp::resolver l_Resolver(m_IoService);
+        auto l_EndpointIterator = l_Resolver.resolve({ l_Match[2], l_Match[3] });
+        m_HdlcdClient.reset(new HdlcdClient(m_IoService, l_Match[1], HdlcdSessionDescriptor(SESSION_TYPE_TRX_ALL, SESSION_FLAGS_DELIVER_RCVD)));
+        m_HdlcdClient->SetOnDataCallback([this](const HdlcdPacketData& a_PacketData) { OnData(a_PacketData); });
+        m_HdlcdClient->SetOnCtrlCallback([this](const HdlcdPacketCtrl& a_PacketCtrl) { OnCtrl(a_PacketCtrl); });
+        m_HdlcdClient->SetOnClosedCallback([this]() { OnClosed(); });
+
+        // The connection is reported as the first step
+        StartTimer(m_DefaultTimeout);
+        m_HdlcdClient->AsyncConnect(l_EndpointIterator, [this](bool a_bSuccess) {
+            if (m_bFinished) {
+                return;
+            } // if
+
+            if (a_bSuccess) {
+                m_bConnected = true;
+                CompleteStep(true);
+            } else {
+                CompleteStep(false, "failed to connect to the HDLC Daemon");
+            } // else
+        }); // AsyncConnect
+    }
+
+    const std::string& GetDevice() const {
+        return m_DeviceScenario.m_Device;
+    }
+
+    bool GetSuccess() const {
+        return m_bSuccess;
+    }
+
+    const std::vector<StepResult>& GetStepResults() const {
+        return m_StepResults;
+    }
+
+private:
+    // Helpers
+    const ScenarioStep* CurrentStep() const {
+        // Index 0 is the connection, followed by the steps of the script
+        return ((m_StepIndex == 0) ? NULL : &m_DeviceScenario.m_Steps[m_StepIndex - 1]);
+    }
+
+    void StartTimer(std::chrono::milliseconds a_Timeout) {
+        m_StepStart = std::chrono::steady_clock::now();
+        m_Timer.expires_from_now(a_Timeout);
+        size_t l_StepIndex = m_StepIndex;
+        m_Timer.async_wait([this, l_StepIndex](const boost::system::error_code& a_ErrorCode) {
+            if ((a_ErrorCode) || (m_bFinished) || (l_StepIndex != m_StepIndex)) {
+                return;
+            } // if
+
+            if ((CurrentStep()) && (CurrentStep()->m_StepType == STEP_TYPE_WAIT)) {
+                CompleteStep(true);
+            } else {
+                CompleteStep(false, "timeout");
+            } // else
+        });
+    }
+
+    void CompleteStep(bool a_bSuccess, const std::string& a_Error = std::string()) {
+        StepResult l_StepResult;
+        l_StepResult.m_ScenarioStep = CurrentStep();
+        l_StepResult.m_bSuccess = a_bSuccess;
+        l_StepResult.m_Latency = (std::chrono::steady_clock::now() - m_StepStart);
+        l_StepResult.m_Error = a_Error;
+        m_StepResults.push_back(l_StepResult);
+        m_Timer.cancel();
+        ++m_StepIndex;
+        if (!a_bSuccess) {
+            Finish(false);
+        } else if (m_StepIndex > m_DeviceScenario.m_Steps.size()) {
+            Finish(true);
+        } else {
+            // Do not recurse: a step may complete synchronously
+            size_t l_StepIndex = m_StepIndex;
+            m_IoService.post([this, l_StepIndex]() {
+                if ((!m_bFinished) && (l_StepIndex == m_StepIndex)) {
+                    ExecuteStep();
+                } // if
+            });
+        } // else
+    }
+
+    void ExecuteStep() {
+        const ScenarioStep& l_ScenarioStep = *CurrentStep();
+        std::chrono::milliseconds l_Timeout = (l_ScenarioStep.m_bHasTimeout ? l_ScenarioStep.m_Timeout : m_DefaultTimeout);
+        StartTimer(l_Timeout);
+        size_t l_StepIndex = m_StepIndex;
+        auto l_OnSendDone = [this, l_StepIndex]() {
+            if ((!m_bFinished) && (l_StepIndex == m_StepIndex)) {
+                CompleteStep(true);
+            } // if
+        };
+
+        switch (l_ScenarioStep.m_StepType) {
+        case STEP_TYPE_LOCK:
+            m_HdlcdClient->Send(HdlcdPacketCtrl::CreatePortStatusRequest(true));
+            break;
+        case STEP_TYPE_UNLOCK:
+            m_HdlcdClient->Send(HdlcdPacketCtrl::CreatePortStatusRequest(false));
+            break;
+        case STEP_TYPE_SEND:
+            // An expectation refers to the responses to this request, not to older frames
+            m_ReceivedPayloads.clear();
+            m_HdlcdClient->Send(HdlcdPacketData::CreatePacket(l_ScenarioStep.m_Payload, true), l_OnSendDone);
+            break;
+        case STEP_TYPE_EXPECT:
+            // The response may have arrived already, e.g., during a wait step after the request
+            CheckExpectation();
+            break;
+        case STEP_TYPE_KILL:
+            m_HdlcdClient->Send(HdlcdPacketCtrl::CreatePortKillRequest(), l_OnSendDone);
+            break;
+        default:
+            // STEP_TYPE_WAIT: the timer completes the step
+            break;
+        } // switch
+    }
+
+    void CheckExpectation() {
+        const ScenarioStep& l_ScenarioStep = *CurrentStep();
+        while (!m_ReceivedPayloads.empty()) {
+            // Payloads are consumed until the first one matches
+            std::vector<unsigned char> l_Payload;
+            l_Payload.swap(m_ReceivedPayloads.front());
+            m_ReceivedPayloads.pop_front();
+            if (std::search(l_Payload.begin(), l_Payload.end(), l_ScenarioStep.m_Payload.begin(), l_ScenarioStep.m_Payload.end()) != l_Payload.end()) {
+                CompleteStep(true);
+                return;
+            } // if
+        } // while
+    }
+
+    void OnData(const HdlcdPacketData& a_PacketData) {
+        if (m_bFinished) {
+            return;
+        } // if
+
+        if (m_ReceivedPayloads.size() >= E_MAX_RECEIVED_PAYLOADS) {
+            m_ReceivedPayloads.pop_front();
+        } // if
+
+        m_ReceivedPayloads.push_back(a_PacketData.GetData());
+        if ((CurrentStep()) && (CurrentStep()->m_StepType == STEP_TYPE_EXPECT)) {
+            CheckExpectation();
+        } // if
+    }
+
+    void OnCtrl(const HdlcdPacketCtrl& a_PacketCtrl) {
+        if ((m_bFinished) || (!CurrentStep()) || (a_PacketCtrl.GetPacketType() != HdlcdPacketCtrl::CTRL_TYPE_PORT_STATUS)) {
+            return;
+        } // if
+
+        if (((CurrentStep()->m_StepType == STEP_TYPE_LOCK) && (a_PacketCtrl.GetIsLockedBySelf())) ||
+            ((CurrentStep()->m_StepType == STEP_TYPE_UNLOCK) && (!a_PacketCtrl.GetIsLockedBySelf()))) {
+            CompleteStep(true);
+        } // if
+    }
+
+    void OnClosed() {
+        m_bConnected = false;
+        if (!m_bFinished) {
+            CompleteStep(false, "connection closed");
+        } // if
+    }
+
+    void Finish(bool a_bSuccess) {
+        m_bFinished = true;
+        m_bSuccess = a_bSuccess;
+        m_Timer.cancel();
+        if (m_bConnected) {
+            // Deliver all pending packets, then close
+            m_HdlcdClient->Shutdown();
+        } else {
+            m_HdlcdClient->Close();
+        } // else
+
+        m_OnFinishedCallback();
+    }
+
+    // Constants
+    enum {
+        E_MAX_RECEIVED_PAYLOADS = 1024
+    };
+
+    // Members
+    boost::asio::io_service& m_IoService;
+    const DeviceScenario& m_DeviceScenario;
+    std::chrono::milliseconds m_DefaultTimeout;
+    std::function<void()> m_OnFinishedCallback;
+    std::unique_ptr<HdlcdClient> m_HdlcdClient;
+    boost::asio::steady_timer m_Timer;
+    std::chrono::steady_clock::time_point m_StepStart;
+    size_t m_StepIndex;
+    std::deque<std::vector<unsigned char>> m_ReceivedPayloads;
+    std::vector<StepResult> m_StepResults;
+    bool m_bConnected;
+    bool m_bFinished;
+    bool m_bSuccess;
+};
+
+#endif // DEVICE_RUNNER_H
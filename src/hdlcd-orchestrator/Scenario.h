@@ -0,0 +1,159 @@
+/**
+ * \file Scenario.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+#include "HexParser.h"
+
+typedef enum {
+    STEP_TYPE_LOCK   = 0, // Suspend the serial port, done if the HDLCd reports the lock
+    STEP_TYPE_UNLOCK = 1, // Resume the serial port, done if the HDLCd reports the release
+    STEP_TYPE_SEND   = 2, // Send a payload, done if it was handed over to the HDLCd
+    STEP_TYPE_EXPECT = 3, // Wait for a received payload containing a byte pattern
+    STEP_TYPE_WAIT   = 4, // Sleep
+    STEP_TYPE_KILL   = 5  // Kill the port handler within the HDLCd
+} E_STEP_TYPE;
+
+typedef struct {
+    E_STEP_TYPE m_StepType;
+    std::vector<unsigned char> m_Payload;
+    bool m_bHasTimeout; // False: use the default timeout
+    std::chrono::milliseconds m_Timeout;
+    std::string m_Text;
+} ScenarioStep;
+
+typedef struct {
+    std::string m_Device;
+    std::vector<ScenarioStep> m_Steps;
+} DeviceScenario;
+
+// Scenario file syntax, one statement per line, "#" starts a comment:
+//   device SerialPort@IPAddress:PortNbr
+//   lock | unlock | kill
+//   send <HEXDUMP>
+//   expect <TIMEOUT_MS> <HEXDUMP>
+//   wait <MS>
+// All statements following a "device" line form the script of that device. An "expect" only matches
+// payloads received after the most recent "send".
+std::vector<DeviceScenario> ReadScenarioFile(const std::string& a_FileName) {
+    std::ifstream l_File(a_FileName.c_str());
+    if (!l_File) {
+        throw std::runtime_error("cannot open the scenario file " + a_FileName);
+    } // if
+
+    std::vector<DeviceScenario> l_DeviceScenarios;
+    std::string l_Line;
+    for (unsigned int l_LineNumber = 1; std::getline(l_File, l_Line); ++l_LineNumber) {
+        size_t l_Comment = l_Line.find('#');
+        if (l_Comment != std::string::npos) {
+            l_Line.erase(l_Comment);
+        } // if
+
+        std::istringstream l_LineStream(l_Line);
+        std::string l_Keyword;
+        if (!(l_LineStream >> l_Keyword)) {
+            continue;
+        } // if
+
+        std::ostringstream l_Where;
+        l_Where << a_FileName << ":" << l_LineNumber << ": ";
+        if (l_Keyword == "device") {
+            DeviceScenario l_DeviceScenario;
+            if (!(l_LineStream >> l_DeviceScenario.m_Device)) {
+                throw std::runtime_error(l_Where.str() + "device specifier missing");
+            } // if
+
+            l_DeviceScenarios.push_back(l_DeviceScenario);
+            continue;
+        } // if
+
+        if (l_DeviceScenarios.empty()) {
+            throw std::runtime_error(l_Where.str() + "statement before the first device");
+        } // if
+
+        ScenarioStep l_ScenarioStep;
+        l_ScenarioStep.m_bHasTimeout = false;
+        l_ScenarioStep.m_Timeout = std::chrono::milliseconds(0);
+        unsigned int l_Milliseconds = 0;
+        if (l_Keyword == "lock") {
+            l_ScenarioStep.m_StepType = STEP_TYPE_LOCK;
+        } else if (l_Keyword == "unlock") {
+            l_ScenarioStep.m_StepType = STEP_TYPE_UNLOCK;
+        } else if (l_Keyword == "kill") {
+            l_ScenarioStep.m_StepType = STEP_TYPE_KILL;
+        } else if (l_Keyword == "send") {
+            l_ScenarioStep.m_StepType = STEP_TYPE_SEND;
+        } else if (l_Keyword == "expect") {
+            l_ScenarioStep.m_StepType = STEP_TYPE_EXPECT;
+            if (!(l_LineStream >> l_Milliseconds)) {
+                throw std::runtime_error(l_Where.str() + "timeout missing");
+            } // if
+
+            l_ScenarioStep.m_bHasTimeout = true;
+        } else if (l_Keyword == "wait") {
+            l_ScenarioStep.m_StepType = STEP_TYPE_WAIT;
+            if (!(l_LineStream >> l_Milliseconds)) {
+                throw std::runtime_error(l_Where.str() + "duration missing");
+            } // if
+
+            l_ScenarioStep.m_bHasTimeout = true;
+        } else {
+            throw std::runtime_error(l_Where.str() + "unknown statement \"" + l_Keyword + "\"");
+        } // else
+
+        l_ScenarioStep.m_Timeout = std::chrono::milliseconds(l_Milliseconds);
+        if ((l_ScenarioStep.m_StepType == STEP_TYPE_SEND) || (l_ScenarioStep.m_StepType == STEP_TYPE_EXPECT)) {
+            std::string l_HexDump;
+            std::streamoff l_Offset = l_LineStream.tellg();
+            std::getline(l_LineStream, l_HexDump);
+            HexParser l_HexParser(65535);
+            l_HexParser.Parse(l_HexDump.data(), l_HexDump.data() + l_HexDump.size());
+            l_HexParser.Finish();
+            if (l_HexParser.GetInvalid()) {
+                std::ostringstream l_Error;
+                l_Error << l_Where.str() << "column " << (l_Offset + l_HexParser.GetErrorColumn()) << ": " << l_HexParser.GetError();
+                throw std::runtime_error(l_Error.str());
+            } // if
+
+            l_ScenarioStep.m_Payload = l_HexParser.GetPayload();
+            if (l_ScenarioStep.m_Payload.empty()) {
+                throw std::runtime_error(l_Where.str() + "payload missing");
+            } // if
+        } // if
+
+        // Keep the statement for the report
+        size_t l_First = l_Line.find_first_not_of(" \t");
+        size_t l_Last = l_Line.find_last_not_of(" \t\r");
+        l_ScenarioStep.m_Text = l_Line.substr(l_First, l_Last - l_First + 1);
+        l_DeviceScenarios.back().m_Steps.push_back(l_ScenarioStep);
+    } // for
+
+    return l_DeviceScenarios;
+}
+
+#endif // SCENARIO_H
@@ -0,0 +1,198 @@
+/**
+ * \file main-hdlcd-orchestrator.cpp
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Config.h"
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+#include "Scenario.h"
+#include "DeviceRunner.h"
+
+double ToMilliseconds(std::chrono::steady_clock::duration a_Duration) {
+    return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(a_Duration).count();
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        // Declare the supported options.
+        boost::program_options::options_description l_Description("Allowed options");
+        l_Description.add_options()
+            ("help,h",     "produce this help message")
+            ("version,v",  "show version information")
+            ("scenario,s", boost::program_options::value<std::string>(),
+                           "scenario file with one script per device")
+            ("threads,t",  boost::program_options::value<unsigned int>()->default_value(std::max(1u, std::thread::hardware_concurrency())),
+                           "number of threads, each with its own io_service")
+            ("timeout",    boost::program_options::value<unsigned int>()->default_value(5000),
+                           "timeout of lock, unlock, send, and kill in ms")
+            ("quiet,q",    "print the summary only")
+        ;
+
+        // Parse the command line
+        boost::program_options::variables_map l_VariablesMap;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, l_Description), l_VariablesMap);
+        boost::program_options::notify(l_VariablesMap);
+        if (l_VariablesMap.count("version")) {
+            std::cerr << "HDLCd test orchestrator version " << HDLCD_TOOLS_VERSION_MAJOR << "." << HDLCD_TOOLS_VERSION_MINOR
+                      << " built with hdlcd-devel version " << HDLCD_DEVEL_VERSION_MAJOR << "." << HDLCD_DEVEL_VERSION_MINOR << std::endl;
+        } // if
+
+        if (l_VariablesMap.count("help")) {
+            std::cout << l_Description << std::endl;
+            std::cout << "Scenario file syntax, one statement per line, \"#\" starts a comment:" << std::endl;
+            std::cout << "  device SerialPort@IPAddress:PortNbr" << std::endl;
+            std::cout << "  lock | unlock | kill" << std::endl;
+            std::cout << "  send <HEXDUMP>" << std::endl;
+            std::cout << "  expect <TIMEOUT_MS> <HEXDUMP>" << std::endl;
+            std::cout << "  wait <MS>" << std::endl;
+            std::cout << "An \"expect\" only matches payloads received after the most recent \"send\"." << std::endl << std::endl;
+            std::cout << "The HDLC test orchestrator is Copyright (C) 2016, and GNU GPL'd, by Florian Evers." << std::endl;
+            std::cout << "Bug reports, feedback, admiration, abuse, etc, to: https://github.com/Strunzdesign/hdlcd-tools" << std::endl;
+            return 1;
+        } // if
+
+        if (!l_VariablesMap.count("scenario")) {
+            std::cout << "hdlcd-orchestrator: you have to specify a scenario file" << std::endl;
+            std::cout << "hdlcd-orchestrator: Use --help for more information." << std::endl;
+            return 1;
+        } // if
+
+        std::vector<DeviceScenario> l_DeviceScenarios = ReadScenarioFile(l_VariablesMap["scenario"].as<std::string>());
+        if (l_DeviceScenarios.empty()) {
+            std::cout << "hdlcd-orchestrator: the scenario file contains no devices" << std::endl;
+            return 1;
+        } // if
+
+        // One io_service per thread, the devices are distributed round robin
+        size_t l_NbrOfThreads = std::min<size_t>(std::max(1u, l_VariablesMap["threads"].as<unsigned int>()), l_DeviceScenarios.size());
+        std::vector<std::unique_ptr<boost::asio::io_service>> l_IoServices;
+        for (size_t l_Index = 0; l_Index < l_NbrOfThreads; ++l_Index) {
+            l_IoServices.emplace_back(new boost::asio::io_service);
+        } // for
+
+        // Install signal handlers
+        boost::asio::signal_set l_Signals(*l_IoServices[0]);
+        l_Signals.add(SIGINT);
+        l_Signals.add(SIGTERM);
+        l_Signals.async_wait([&l_IoServices](const boost::system::error_code& a_ErrorCode, int) {
+            if (!a_ErrorCode) {
+                for (auto it = l_IoServices.begin(); it != l_IoServices.end(); ++it) {
+                    (*it)->stop();
+                } // for
+            } // if
+        });
+
+        // Prepare and start all devices
+        std::atomic<size_t> l_NbrOfRunning(l_DeviceScenarios.size());
+        std::vector<std::unique_ptr<DeviceRunner>> l_DeviceRunners;
+        std::chrono::milliseconds l_DefaultTimeout(l_VariablesMap["timeout"].as<unsigned int>());
+        for (size_t l_Index = 0; l_Index < l_DeviceScenarios.size(); ++l_Index) {
+            l_DeviceRunners.emplace_back(new DeviceRunner(*l_IoServices[l_Index % l_NbrOfThreads], l_DeviceScenarios[l_Index], l_DefaultTimeout,
+                                                          [&l_NbrOfRunning, &l_IoServices, &l_Signals]() {
+                if (--l_NbrOfRunning == 0) {
+                    // All scripts are done, the io_services return as soon as all connections are closed
+                    l_IoServices[0]->post([&l_Signals]() { l_Signals.cancel(); });
+                } // if
+            }));
+            l_DeviceRunners.back()->Start();
+        } // for
+
+        // Start event processing
+        auto l_Start = std::chrono::steady_clock::now();
+        std::vector<std::thread> l_Threads;
+        for (size_t l_Index = 1; l_Index < l_NbrOfThreads; ++l_Index) {
+            boost::asio::io_service& l_IoService = *l_IoServices[l_Index];
+            l_Threads.emplace_back([&l_IoService]() { l_IoService.run(); });
+        } // for
+
+        l_IoServices[0]->run();
+        for (auto it = l_Threads.begin(); it != l_Threads.end(); ++it) {
+            it->join();
+        } // for
+
+        auto l_Runtime = (std::chrono::steady_clock::now() - l_Start);
+
+        // Report per step and per statement type
+        bool l_bQuiet = l_VariablesMap.count("quiet");
+        size_t l_NbrOfFailed = 0;
+        std::map<std::string, std::vector<double>> l_Latencies;
+        std::cout << std::fixed << std::setprecision(3);
+        for (auto l_DeviceRunner = l_DeviceRunners.begin(); l_DeviceRunner != l_DeviceRunners.end(); ++l_DeviceRunner) {
+            if (!(*l_DeviceRunner)->GetSuccess()) {
+                ++l_NbrOfFailed;
+            } // if
+
+            if (!l_bQuiet) {
+                std::cout << "Device " << (*l_DeviceRunner)->GetDevice() << ": " << ((*l_DeviceRunner)->GetSuccess() ? "PASSED" : "FAILED") << std::endl;
+            } // if
+
+            const std::vector<StepResult>& l_StepResults = (*l_DeviceRunner)->GetStepResults();
+            for (auto l_StepResult = l_StepResults.begin(); l_StepResult != l_StepResults.end(); ++l_StepResult) {
+                std::string l_Text = (l_StepResult->m_ScenarioStep ? l_StepResult->m_ScenarioStep->m_Text : std::string("connect"));
+                double l_Milliseconds = ToMilliseconds(l_StepResult->m_Latency);
+                if (!l_bQuiet) {
+                    std::cout << "  " << std::setw(10) << l_Milliseconds << " ms  " << (l_StepResult->m_bSuccess ? "ok    " : "FAILED") << "  " << l_Text;
+                    if (!l_StepResult->m_Error.empty()) {
+                        std::cout << " (" << l_StepResult->m_Error << ")";
+                    } // if
+
+                    std::cout << std::endl;
+                } // if
+
+                if (l_StepResult->m_bSuccess) {
+                    l_Latencies[l_Text.substr(0, l_Text.find(' '))].push_back(l_Milliseconds);
+                } // if
+            } // for
+        } // for
+
+        std::cout << "Statement      count      min ms      avg ms      p99 ms      max ms" << std::endl;
+        for (auto it = l_Latencies.begin(); it != l_Latencies.end(); ++it) {
+            std::vector<double>& l_Values = it->second;
+            std::sort(l_Values.begin(), l_Values.end());
+            double l_Sum = 0.0;
+            for (auto l_Value = l_Values.begin(); l_Value != l_Values.end(); ++l_Value) {
+                l_Sum += *l_Value;
+            } // for
+
+            std::cout << std::left << std::setw(10) << it->first << std::right << std::setw(10) << l_Values.size()
+                      << std::setw(12) << l_Values.front() << std::setw(12) << (l_Sum / l_Values.size())
+                      << std::setw(12) << l_Values[(l_Values.size() - 1) * 99 / 100] << std::setw(12) << l_Values.back() << std::endl;
+        } // for
+
+        std::cout << (l_DeviceRunners.size() - l_NbrOfFailed) << " of " << l_DeviceRunners.size() << " devices passed in "
+                  << ToMilliseconds(l_Runtime) << " ms" << std::endl;
+        if (l_NbrOfFailed) {
+            return 1;
+        } // if
+    } catch (std::exception& a_Error) {
+        std::cerr << "Exception: " << a_Error.what() << "\n";
+        return 1;
+    } // catch
+
+    return 0;
+}
@@ -21,11 +21,13 @@
 
 #include "Config.h"
 #include <iostream>
+#include <csignal>
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
 #include <boost/regex.hpp>
 #include "HdlcdClient.h"
-#include "HdlcdPacketDataPrinter.h"
+#include "PcapFifoWriter.h"
+#include "FrameTimestamp.h"
 
 int main(int argc, char* argv[]) {
     try {
@@ -39,6 +41,13 @@ int main(int argc, char* argv[]) {
                           "syntax: SerialPort@IPAddess:PortNbr\n"
                           "  linux:   /dev/ttyUSB0@localhost:5001\n"
                           "  windows: //./COM1@example.com:5001")
+            ("fifo,f",    boost::program_options::value<std::string>(),
+                          "named FIFO to stream the pcap file to,\n"
+                          "created if it does not exist")
+            ("flush-delay", boost::program_options::value<unsigned int>()->default_value(50),
+                          "hand frames to the reader after at most N ms")
+            ("backlog",   boost::program_options::value<unsigned int>()->default_value(4096),
+                          "drop frames if N KiB wait for a slow reader")
         ;
 
         // Parse the command line
@@ -63,12 +72,21 @@ int main(int argc, char* argv[]) {
             return 1;
         } // if
 
+        if (!l_VariablesMap.count("fifo")) {
+            std::cout << "hdlcd-pcapstreamer: you have to specify a named FIFO to write to" << std::endl;
+            std::cout << "hdlcd-pcapstreamer: Use --help for more information." << std::endl;
+            return 1;
+        } // if
+
         // Install signal handlers
         boost::asio::io_service l_IoService;
         boost::asio::signal_set l_Signals(l_IoService);
         l_Signals.add(SIGINT);
         l_Signals.add(SIGTERM);
         l_Signals.async_wait([&l_IoService](boost::system::error_code, int){ l_IoService.stop(); });
+
+        // A reader that went away must result in EPIPE, not in termination
+        std::signal(SIGPIPE, SIG_IGN);
         
         // Parse the destination specifier
         static boost::regex s_RegEx("^(.*?)@(.*?):(.*?)$");
@@ -78,19 +96,28 @@ int main(int argc, char* argv[]) {
             boost::asio::ip::tcp::resolver l_Resolver(l_IoService);
             auto l_EndpointIterator = l_Resolver.resolve({ l_Match[2], l_Match[3] });
             
+            // Prepare the pcap stream, frames are dropped as long as no reader is attached
+            PcapFifoWriter l_PcapFifoWriter(l_IoService, l_VariablesMap["fifo"].as<std::string>(), PCAP_LINKTYPE_HDLC,
+                                            std::chrono::milliseconds(l_VariablesMap["flush-delay"].as<unsigned int>()),
+                                            (size_t(l_VariablesMap["backlog"].as<unsigned int>()) * 1024));
+
             // Prepare the HDLCd client entity
             HdlcdClient l_HdlcdClient(l_IoService, l_Match[1], HdlcdSessionDescriptor(SESSION_TYPE_RX_HDLC, (SESSION_FLAGS_DELIVER_SENT | SESSION_FLAGS_DELIVER_RCVD)));
             l_HdlcdClient.SetOnClosedCallback([&l_IoService](){ l_IoService.stop(); });
-            l_HdlcdClient.SetOnDataCallback([](const HdlcdPacketData& a_PacketData){ HdlcdPacketDataPrinter(a_PacketData); });
-            l_HdlcdClient.AsyncConnect(l_EndpointIterator, [&l_Signals](bool a_bSuccess) {
+            l_HdlcdClient.SetOnDataCallback([&l_PcapFifoWriter](const HdlcdPacketData& a_PacketData) {
+                l_PcapFifoWriter.Write(FrameTimestamp::Now().GetMicroseconds(), a_PacketData.GetData());
+            });
+            l_HdlcdClient.AsyncConnect(l_EndpointIterator, [&l_Signals, &l_PcapFifoWriter](bool a_bSuccess) {
                 if (!a_bSuccess) {
                     std::cout << "Failed to connect to the HDLC Daemon!" << std::endl;
                     l_Signals.cancel();
+                    l_PcapFifoWriter.Close();
                 } // if
             }); // AsyncConnect
 
             // Start event processing
             l_IoService.run();
+            l_PcapFifoWriter.PrintStatistics(std::cerr);
         } else {
             throw boost::program_options::validation_error(boost::program_options::validation_error::invalid_option_value);
         } // else
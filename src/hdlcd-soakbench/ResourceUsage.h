@@ -0,0 +1,67 @@
+/**
+ * \file ResourceUsage.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESOURCE_USAGE_H
+#define RESOURCE_USAGE_H
+
+#include <fstream>
+#include <chrono>
+#include <cstdint>
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// A snapshot of the memory and CPU time consumed by this process so far (Linux)
+struct ResourceUsage {
+    uint64_t m_RssBytes;
+    uint64_t m_HeapInUseBytes;
+    uint64_t m_HeapArenaBytes;
+    std::chrono::nanoseconds m_CpuTime;
+
+    static ResourceUsage Sample() {
+        ResourceUsage l_ResourceUsage;
+
+        // Resident set size: the second field of statm, in pages
+        uint64_t l_SizePages = 0;
+        uint64_t l_ResidentPages = 0;
+        std::ifstream l_Statm("/proc/self/statm");
+        l_Statm >> l_SizePages >> l_ResidentPages;
+        l_ResourceUsage.m_RssBytes = (l_ResidentPages * ::sysconf(_SC_PAGESIZE));
+
+        // Heap: bytes handed out by malloc versus bytes obtained from the system, the difference is fragmentation
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 33)))
+        struct mallinfo2 l_MallInfo = ::mallinfo2();
+#else
+        struct mallinfo l_MallInfo = ::mallinfo();
+#endif
+        l_ResourceUsage.m_HeapInUseBytes = (uint64_t(l_MallInfo.uordblks) + uint64_t(l_MallInfo.hblkhd));
+        l_ResourceUsage.m_HeapArenaBytes = (uint64_t(l_MallInfo.arena) + uint64_t(l_MallInfo.hblkhd));
+
+        // CPU time: user and system
+        struct rusage l_Usage;
+        ::getrusage(RUSAGE_SELF, &l_Usage);
+        l_ResourceUsage.m_CpuTime = (std::chrono::seconds(l_Usage.ru_utime.tv_sec + l_Usage.ru_stime.tv_sec) +
+                                     std::chrono::microseconds(l_Usage.ru_utime.tv_usec + l_Usage.ru_stime.tv_usec));
+        return l_ResourceUsage;
+    }
+};
+
+#endif // RESOURCE_USAGE_H
@@ -0,0 +1,204 @@
+/**
+ * \file main-hdlcd-soakbench.cpp
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Config.h"
+#include <iostream>
+#include <iomanip>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <boost/program_options.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "LogClientFormatter.h"
+#include "HdlcdPacketCtrlPrinter.h"
+#include "ResourceUsage.h"
+
+// Discards everything, but still forces the formatters through the complete iostream machinery
+class NullStreamBuffer: public std::streambuf {
+protected:
+    int_type overflow(int_type a_Char) {
+        return traits_type::not_eof(a_Char);
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize a_Count) {
+        return a_Count;
+    }
+};
+
+struct SoakThresholds {
+    uint64_t m_MaxRssGrowth;
+    uint64_t m_MaxHeapGrowth;
+    uint64_t m_MaxCostPerFrame; // ns
+};
+
+// Run a_NbrOfFrames steps split into a_NbrOfCheckpoints equal slices, each being one "hour" of simulated time. The first slice
+// is the warm-up: caches, locales, and the heap have settled afterwards, thus growth and cost are measured from its end.
+template<class Step>
+bool RunSoak(const std::string& a_Name, size_t a_NbrOfFrames, size_t a_NbrOfCheckpoints, const SoakThresholds& a_Thresholds, Step a_Step) {
+    size_t l_FramesPerCheckpoint = std::max<size_t>(1, (a_NbrOfFrames / a_NbrOfCheckpoints));
+    ResourceUsage l_Baseline = ResourceUsage::Sample();
+    ResourceUsage l_Previous = l_Baseline;
+    uint64_t l_MaxRss = 0;
+    uint64_t l_MaxHeap = 0;
+    size_t l_Frame = 0;
+    for (size_t l_Checkpoint = 1; l_Checkpoint <= a_NbrOfCheckpoints; ++l_Checkpoint) {
+        for (size_t l_Index = 0; l_Index < l_FramesPerCheckpoint; ++l_Index, ++l_Frame) {
+            a_Step(l_Frame);
+        } // for
+
+        ResourceUsage l_Current = ResourceUsage::Sample();
+        double l_Cost = (double(std::chrono::duration_cast<std::chrono::nanoseconds>(l_Current.m_CpuTime - l_Previous.m_CpuTime).count()) / l_FramesPerCheckpoint);
+        std::cout << std::left << std::setw(9) << a_Name << std::right << " hour " << std::setw(2) << std::setfill('0') << l_Checkpoint << std::setfill(' ') << ": "
+                  << "RSS " << std::setw(7) << (l_Current.m_RssBytes / 1024) << " KiB, heap " << std::setw(7) << (l_Current.m_HeapInUseBytes / 1024)
+                  << " KiB in use / " << std::setw(7) << (l_Current.m_HeapArenaBytes / 1024) << " KiB total, "
+                  << std::fixed << std::setprecision(1) << l_Cost << " ns/frame" << std::endl;
+        if (l_Checkpoint == 1) {
+            l_Baseline = l_Current;
+        } else {
+            l_MaxRss  = std::max(l_MaxRss,  l_Current.m_RssBytes);
+            l_MaxHeap = std::max(l_MaxHeap, l_Current.m_HeapInUseBytes);
+        } // else
+
+        l_Previous = l_Current;
+    } // for
+
+    if (a_NbrOfCheckpoints < 2) {
+        return true;
+    } // if
+
+    // Evaluate everything after the warm-up
+    uint64_t l_RssGrowth  = ((l_MaxRss  > l_Baseline.m_RssBytes)       ? (l_MaxRss  - l_Baseline.m_RssBytes)       : 0);
+    uint64_t l_HeapGrowth = ((l_MaxHeap > l_Baseline.m_HeapInUseBytes) ? (l_MaxHeap - l_Baseline.m_HeapInUseBytes) : 0);
+    double l_Cost = (double(std::chrono::duration_cast<std::chrono::nanoseconds>(l_Previous.m_CpuTime - l_Baseline.m_CpuTime).count()) /
+                     (l_FramesPerCheckpoint * (a_NbrOfCheckpoints - 1)));
+    std::cout << std::left << std::setw(9) << a_Name << std::right << " summary: RSS growth " << (l_RssGrowth / 1024) << " KiB, heap growth " << (l_HeapGrowth / 1024)
+              << " KiB, " << std::fixed << std::setprecision(1) << l_Cost << " ns/frame" << std::endl;
+
+    bool l_bPassed = true;
+    if (l_RssGrowth > a_Thresholds.m_MaxRssGrowth) {
+        std::cerr << a_Name << ": FAILED, RSS grew by " << (l_RssGrowth / 1024) << " KiB" << std::endl;
+        l_bPassed = false;
+    } // if
+
+    if (l_HeapGrowth > a_Thresholds.m_MaxHeapGrowth) {
+        std::cerr << a_Name << ": FAILED, heap grew by " << (l_HeapGrowth / 1024) << " KiB" << std::endl;
+        l_bPassed = false;
+    } // if
+
+    if ((a_Thresholds.m_MaxCostPerFrame) && (l_Cost > a_Thresholds.m_MaxCostPerFrame)) {
+        std::cerr << a_Name << ": FAILED, " << std::fixed << std::setprecision(1) << l_Cost << " ns/frame" << std::endl;
+        l_bPassed = false;
+    } // if
+
+    return l_bPassed;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        // Declare the supported options.
+        boost::program_options::options_description l_Description("Allowed options");
+        l_Description.add_options()
+            ("help,h",    "produce this help message")
+            ("version,v", "show version information")
+            ("tool",      boost::program_options::value<std::string>()->default_value("all"),
+                          "formatters to exercise: logclient, monitor, or all")
+            ("rate",      boost::program_options::value<unsigned int>()->default_value(50),
+                          "simulated frames per second")
+            ("hours",     boost::program_options::value<unsigned int>()->default_value(24),
+                          "simulated duration in hours, one sample per hour")
+            ("max-rss-growth", boost::program_options::value<unsigned int>()->default_value(1024),
+                          "fail if the RSS grows by more than N KiB")
+            ("max-heap-growth", boost::program_options::value<unsigned int>()->default_value(64),
+                          "fail if the heap in use grows by more than N KiB")
+            ("max-cost",  boost::program_options::value<unsigned int>()->default_value(5000),
+                          "fail if formatting costs more than N ns of CPU time\n"
+                          "per frame, 0: unlimited")
+        ;
+
+        // Parse the command line
+        boost::program_options::variables_map l_VariablesMap;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, l_Description), l_VariablesMap);
+        boost::program_options::notify(l_VariablesMap);
+        if (l_VariablesMap.count("version")) {
+            std::cerr << "HDLCd tools soak benchmark version " << HDLCD_TOOLS_VERSION_MAJOR << "." << HDLCD_TOOLS_VERSION_MINOR
+                      << " built with hdlcd-devel version " << HDLCD_DEVEL_VERSION_MAJOR << "." << HDLCD_DEVEL_VERSION_MINOR << std::endl;
+        } // if
+
+        if (l_VariablesMap.count("help")) {
+            std::cout << l_Description << std::endl;
+            std::cout << "The soak benchmark of the HDLCd tools is Copyright (C) 2016, and GNU GPL'd, by Florian Evers." << std::endl;
+            std::cout << "Bug reports, feedback, admiration, abuse, etc, to: https://github.com/Strunzdesign/hdlcd-tools" << std::endl;
+            return 1;
+        } // if
+
+        const std::string& l_Tool = l_VariablesMap["tool"].as<std::string>();
+        if ((l_Tool != "logclient") && (l_Tool != "monitor") && (l_Tool != "all")) {
+            std::cout << "hdlcd-soakbench: the tool must be \"logclient\", \"monitor\", or \"all\"" << std::endl;
+            return 1;
+        } // if
+
+        size_t l_NbrOfCheckpoints = std::max(1u, l_VariablesMap["hours"].as<unsigned int>());
+        size_t l_NbrOfFrames = (size_t(l_VariablesMap["rate"].as<unsigned int>()) * 3600 * l_NbrOfCheckpoints);
+        SoakThresholds l_Thresholds;
+        l_Thresholds.m_MaxRssGrowth    = (uint64_t(l_VariablesMap["max-rss-growth"].as<unsigned int>()) * 1024);
+        l_Thresholds.m_MaxHeapGrowth   = (uint64_t(l_VariablesMap["max-heap-growth"].as<unsigned int>()) * 1024);
+        l_Thresholds.m_MaxCostPerFrame = l_VariablesMap["max-cost"].as<unsigned int>();
+
+        // Synthetic frames of random length and content, generated in advance to keep the generator out of the measurement
+        std::mt19937 l_Random(0x48444c43);
+        std::uniform_int_distribution<int> l_Length(1, 256);
+        std::uniform_int_distribution<int> l_Byte(0, 255);
+        std::vector<std::vector<unsigned char>> l_Frames(1024);
+        for (auto l_Frame = l_Frames.begin(); l_Frame != l_Frames.end(); ++l_Frame) {
+            l_Frame->resize(l_Length(l_Random));
+            for (auto l_Data = l_Frame->begin(); l_Data != l_Frame->end(); ++l_Data) {
+                *l_Data = l_Byte(l_Random);
+            } // for
+        } // for
+
+        NullStreamBuffer l_NullStreamBuffer;
+        std::ostream l_NullStream(&l_NullStreamBuffer);
+        const boost::posix_time::ptime l_Start(boost::gregorian::date(2016, 2, 19));
+        const uint64_t l_Interval = (1000000 / std::max(1u, l_VariablesMap["rate"].as<unsigned int>())); // us
+        bool l_bPassed = true;
+        if (l_Tool != "monitor") {
+            // hdlcd-logclient: one log entry per received frame with the simulated time of arrival
+            l_bPassed &= RunSoak("logclient", l_NbrOfFrames, l_NbrOfCheckpoints, l_Thresholds, [&](size_t a_Frame) {
+                PrintLogEntry(l_NullStream, (l_Start + boost::posix_time::microseconds(a_Frame * l_Interval)), l_Frames[a_Frame % l_Frames.size()]);
+            });
+        } // if
+
+        if (l_Tool != "logclient") {
+            // hdlcd-monitor: cycle through all combinations of the port status
+            l_bPassed &= RunSoak("monitor", l_NbrOfFrames, l_NbrOfCheckpoints, l_Thresholds, [&](size_t a_Frame) {
+                PrintPortStatus(l_NullStream, (a_Frame & 0x01), (a_Frame & 0x02), (a_Frame & 0x04));
+            });
+        } // if
+
+        return (l_bPassed ? 0 : 1);
+    } catch (std::exception& a_Error) {
+        std::cerr << "Exception: " << a_Error.what() << "\n";
+    } // catch
+
+    return 1;
+}
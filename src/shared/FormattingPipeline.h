@@ -0,0 +1,195 @@
+/**
+ * \file FormattingPipeline.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FORMATTING_PIPELINE_H
+#define FORMATTING_PIPELINE_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include "HdlcdPacketData.h"
+#include "FrameTimestamp.h"
+#include "StageProfiler.h"
+
+// One raw frame as handed over from the network thread to the formatting workers
+typedef struct {
+    std::vector<unsigned char> m_Buffer;
+    bool m_bWasSent;
+    bool m_bInvalid;
+    FrameTimestamp m_Timestamp;
+} FormattingPipelineEntry;
+
+class FormattingPipeline {
+public:
+    // CTOR: the formatter is called on the worker threads, the output stream is only written by the output thread
+    FormattingPipeline(size_t a_NbrOfWorkers, std::function<void(std::ostream&, const FormattingPipelineEntry&)> a_Formatter,
+                       std::ostream& a_OutputStream = std::cout, size_t a_NbrOfSlots = 4096):
+        m_Formatter(a_Formatter), m_OutputStream(a_OutputStream), m_Slots(a_NbrOfSlots), m_bStopped(false),
+        m_NextToPublish(0), m_NextToClaim(0), m_NextToWrite(0) {
+        for (size_t l_Index = 0; l_Index < a_NbrOfWorkers; ++l_Index) {
+            m_Workers.emplace_back([this](){ FormatterLoop(); });
+        } // for
+
+        m_OutputThread = std::thread([this](){ OutputLoop(); });
+    }
+
+    // DTOR
+    ~FormattingPipeline() {
+        Stop();
+    }
+
+    // Called by the network thread only: copy the frame into the next slot and return immediately
+    void Push(const HdlcdPacketData& a_PacketData, const FrameTimestamp& a_FrameTimestamp) {
+        Push(a_PacketData.GetWasSent(), a_PacketData.GetInvalid(), a_FrameTimestamp, a_PacketData.GetData());
+    }
+
+    void Push(bool a_bWasSent, bool a_bInvalid, const FrameTimestamp& a_FrameTimestamp, const std::vector<unsigned char>& a_Buffer) {
+        uint64_t l_Sequence = m_NextToPublish.load(std::memory_order_relaxed);
+        Slot& l_Slot = m_Slots[l_Sequence % m_Slots.size()];
+        for (unsigned int l_Spins = 0; l_Slot.m_Stage.load(std::memory_order_acquire) != SLOT_STAGE_FREE; ++l_Spins) {
+            // All slots are occupied: the workers are behind. Block the network thread, TCP flow control does the rest.
+            Backoff(l_Spins);
+        } // for
+
+        l_Slot.m_Entry.m_Buffer.assign(a_Buffer.begin(), a_Buffer.end());
+        l_Slot.m_Entry.m_bWasSent  = a_bWasSent;
+        l_Slot.m_Entry.m_bInvalid  = a_bInvalid;
+        l_Slot.m_Entry.m_Timestamp = a_FrameTimestamp;
+        l_Slot.m_Sequence.store(l_Sequence, std::memory_order_release);
+        l_Slot.m_Stage.store(SLOT_STAGE_FILLED, std::memory_order_release);
+        m_NextToPublish.store(l_Sequence + 1, std::memory_order_release);
+    }
+
+    // Flush all frames pushed so far and terminate all threads
+    void Stop() {
+        if (m_bStopped.exchange(true)) {
+            return;
+        } // if
+
+        m_OutputThread.join();
+        for (auto it = m_Workers.begin(); it != m_Workers.end(); ++it) {
+            it->join();
+        } // for
+
+        m_OutputStream.flush();
+    }
+
+private:
+    // Helpers
+    static void Backoff(unsigned int a_Spins) {
+        if (a_Spins < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds((a_Spins < 1024) ? 50 : 1000));
+        } // else
+    }
+
+    void FormatterLoop() {
+        STAGE_PROFILER_THREAD("formatter");
+        std::ostringstream l_FormatStream;
+        while (true) {
+            // Claim the next sequence number and wait until the network thread published it
+            uint64_t l_Sequence = m_NextToClaim.fetch_add(1);
+            Slot& l_Slot = m_Slots[l_Sequence % m_Slots.size()];
+            for (unsigned int l_Spins = 0; ; ++l_Spins) {
+                if ((l_Slot.m_Sequence.load(std::memory_order_acquire) == l_Sequence) && (l_Slot.m_Stage.load(std::memory_order_acquire) == SLOT_STAGE_FILLED)) {
+                    break;
+                } // if
+
+                if ((m_bStopped.load()) && (l_Sequence >= m_NextToPublish.load(std::memory_order_acquire))) {
+                    // Nothing left that was published before the stop request
+                    return;
+                } // if
+
+                Backoff(l_Spins);
+            } // for
+
+            l_FormatStream.str(std::string());
+            l_FormatStream.clear();
+            m_Formatter(l_FormatStream, l_Slot.m_Entry);
+            l_Slot.m_Text = l_FormatStream.str();
+            l_Slot.m_Stage.store(SLOT_STAGE_FORMATTED, std::memory_order_release);
+        } // while
+    }
+
+    void OutputLoop() {
+        STAGE_PROFILER_THREAD("output");
+        while (true) {
+            // Emit formatted frames strictly in the order they were received
+            Slot& l_Slot = m_Slots[m_NextToWrite % m_Slots.size()];
+            for (unsigned int l_Spins = 0; l_Slot.m_Stage.load(std::memory_order_acquire) != SLOT_STAGE_FORMATTED; ++l_Spins) {
+                if ((m_bStopped.load()) && (m_NextToWrite >= m_NextToPublish.load(std::memory_order_acquire))) {
+                    return;
+                } // if
+
+                if (l_Spins == 0) {
+                    // Caught up: coalesce all writes since the last flush
+                    STAGE_PROFILER_SCOPE(PROFILER_STAGE_WRITE);
+                    m_OutputStream.flush();
+                } // if
+
+                Backoff(l_Spins);
+            } // for
+
+            {
+                STAGE_PROFILER_SCOPE(PROFILER_STAGE_WRITE);
+                m_OutputStream.write(l_Slot.m_Text.data(), l_Slot.m_Text.size());
+            }
+
+            l_Slot.m_Stage.store(SLOT_STAGE_FREE, std::memory_order_release);
+            ++m_NextToWrite;
+        } // while
+    }
+
+    // Types
+    typedef enum {
+        SLOT_STAGE_FREE = 0,
+        SLOT_STAGE_FILLED,
+        SLOT_STAGE_FORMATTED
+    } E_SLOT_STAGE;
+
+    struct Slot {
+        Slot(): m_Sequence(0), m_Stage(SLOT_STAGE_FREE) {}
+        FormattingPipelineEntry m_Entry;
+        std::string m_Text;
+        std::atomic<uint64_t> m_Sequence;
+        std::atomic<int> m_Stage;
+    };
+
+    // Members
+    std::function<void(std::ostream&, const FormattingPipelineEntry&)> m_Formatter;
+    std::ostream& m_OutputStream;
+    std::vector<Slot> m_Slots;
+    std::vector<std::thread> m_Workers;
+    std::thread m_OutputThread;
+    std::atomic<bool> m_bStopped;
+    std::atomic<uint64_t> m_NextToPublish;
+    std::atomic<uint64_t> m_NextToClaim;
+    uint64_t m_NextToWrite;
+};
+
+#endif // FORMATTING_PIPELINE_H
@@ -0,0 +1,166 @@
+/**
+ * \file FrameRingBuffer.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FRAME_RING_BUFFER_H
+#define FRAME_RING_BUFFER_H
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include "MemoryPlacement.h"
+
+// One frame as stored in the ring buffer
+typedef struct {
+    bool m_bWasSent;
+    bool m_bInvalid;
+    int64_t m_Timestamp; // Microseconds since the epoch, UTC
+    const unsigned char* m_Data;
+    size_t m_Length;
+} FrameRingBufferEntry;
+
+class FrameRingBuffer {
+public:
+    // CTOR: all memory is allocated and touched here, recording a frame later on only copies bytes
+    FrameRingBuffer(size_t a_Capacity, bool a_bHugePages = false, int a_NumaNode = -1):
+        m_Buffer(a_Capacity, a_bHugePages, a_NumaNode), m_Head(0), m_Tail(0), m_Used(0), m_NbrOfFrames(0), m_NbrOfDroppedFrames(0) {
+    }
+
+    void Push(bool a_bWasSent, bool a_bInvalid, int64_t a_Timestamp, const std::vector<unsigned char>& a_Data) {
+        size_t l_RecordSize = (E_HEADER_SIZE + a_Data.size());
+        if (l_RecordSize > m_Buffer.GetSize()) {
+            ++m_NbrOfDroppedFrames;
+            return;
+        } // if
+
+        // Evict the oldest frames until the new one fits
+        while ((m_Used + l_RecordSize) > m_Buffer.GetSize()) {
+            unsigned char l_Header[E_HEADER_SIZE];
+            Read(m_Tail, l_Header, E_HEADER_SIZE);
+            uint32_t l_Length;
+            ::memcpy(&l_Length, l_Header, sizeof(l_Length));
+            m_Tail = ((m_Tail + E_HEADER_SIZE + l_Length) % m_Buffer.GetSize());
+            m_Used -= (E_HEADER_SIZE + l_Length);
+            --m_NbrOfFrames;
+        } // while
+
+        unsigned char l_Header[E_HEADER_SIZE];
+        uint32_t l_Length = a_Data.size();
+        ::memcpy(l_Header, &l_Length, sizeof(l_Length));
+        l_Header[4] = ((a_bWasSent ? 0x01 : 0x00) | (a_bInvalid ? 0x02 : 0x00));
+        ::memcpy(l_Header + 5, &a_Timestamp, sizeof(a_Timestamp));
+        Write(l_Header, E_HEADER_SIZE);
+        if (!a_Data.empty()) {
+            Write(a_Data.data(), a_Data.size());
+        } // if
+
+        m_Used += l_RecordSize;
+        ++m_NbrOfFrames;
+    }
+
+    // Iterate over all stored frames, oldest first
+    void ForEach(std::function<void(const FrameRingBufferEntry&)> a_Callback) const {
+        std::vector<unsigned char> l_Data;
+        size_t l_Position = m_Tail;
+        for (size_t l_Index = 0; l_Index < m_NbrOfFrames; ++l_Index) {
+            unsigned char l_Header[E_HEADER_SIZE];
+            Read(l_Position, l_Header, E_HEADER_SIZE);
+            uint32_t l_Length;
+            ::memcpy(&l_Length, l_Header, sizeof(l_Length));
+            FrameRingBufferEntry l_Entry;
+            l_Entry.m_bWasSent = (l_Header[4] & 0x01);
+            l_Entry.m_bInvalid = (l_Header[4] & 0x02);
+            ::memcpy(&l_Entry.m_Timestamp, l_Header + 5, sizeof(l_Entry.m_Timestamp));
+            l_Position = ((l_Position + E_HEADER_SIZE) % m_Buffer.GetSize());
+            if ((l_Position + l_Length) <= m_Buffer.GetSize()) {
+                // Contiguous, no copy needed
+                l_Entry.m_Data = (m_Buffer.GetData() + l_Position);
+            } else {
+                l_Data.resize(l_Length);
+                Read(l_Position, l_Data.data(), l_Length);
+                l_Entry.m_Data = l_Data.data();
+            } // else
+
+            l_Entry.m_Length = l_Length;
+            a_Callback(l_Entry);
+            l_Position = ((l_Position + l_Length) % m_Buffer.GetSize());
+        } // for
+    }
+
+    // Copy all stored frames into a ring buffer of at least the same capacity, e.g., to process them on another thread
+    void CopyTo(FrameRingBuffer& a_Snapshot) const {
+        a_Snapshot.Clear();
+        if (m_Used > a_Snapshot.m_Buffer.GetSize()) {
+            return;
+        } // if
+
+        Read(m_Tail, a_Snapshot.m_Buffer.GetData(), m_Used);
+        a_Snapshot.m_Head = (m_Used % a_Snapshot.m_Buffer.GetSize());
+        a_Snapshot.m_Used = m_Used;
+        a_Snapshot.m_NbrOfFrames = m_NbrOfFrames;
+    }
+
+    void Clear() {
+        m_Head = 0;
+        m_Tail = 0;
+        m_Used = 0;
+        m_NbrOfFrames = 0;
+    }
+
+    size_t GetNbrOfFrames() const {
+        return m_NbrOfFrames;
+    }
+
+    size_t GetNbrOfDroppedFrames() const {
+        return m_NbrOfDroppedFrames;
+    }
+
+private:
+    // Helpers
+    void Write(const unsigned char* a_Data, size_t a_Length) {
+        size_t l_First = std::min(a_Length, (m_Buffer.GetSize() - m_Head));
+        ::memcpy(m_Buffer.GetData() + m_Head, a_Data, l_First);
+        ::memcpy(m_Buffer.GetData(), a_Data + l_First, (a_Length - l_First));
+        m_Head = ((m_Head + a_Length) % m_Buffer.GetSize());
+    }
+
+    void Read(size_t a_Position, unsigned char* a_Data, size_t a_Length) const {
+        size_t l_First = std::min(a_Length, (m_Buffer.GetSize() - a_Position));
+        ::memcpy(a_Data, m_Buffer.GetData() + a_Position, l_First);
+        ::memcpy(a_Data + l_First, m_Buffer.GetData(), (a_Length - l_First));
+    }
+
+    // Constants: 4 bytes length, 1 byte flags, 8 bytes timestamp
+    enum {
+        E_HEADER_SIZE = 13
+    };
+
+    // Members
+    PlacedBuffer m_Buffer;
+    size_t m_Head;
+    size_t m_Tail;
+    size_t m_Used;
+    size_t m_NbrOfFrames;
+    size_t m_NbrOfDroppedFrames;
+};
+
+#endif // FRAME_RING_BUFFER_H
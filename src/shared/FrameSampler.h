@@ -0,0 +1,252 @@
+/**
+ * \file FrameSampler.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FRAME_SAMPLER_H
+#define FRAME_SAMPLER_H
+
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include "HdlcdPacketData.h"
+#include "FrameTimestamp.h"
+
+typedef enum {
+    SAMPLING_MODE_NONE = 0,
+    SAMPLING_MODE_EVERY,     // Every Nth frame
+    SAMPLING_MODE_RESERVOIR, // N random frames per interval, emitted at the end of the interval
+    SAMPLING_MODE_RATE       // At most N frames per second, bursts of up to N frames
+} E_SAMPLING_MODE;
+
+// Syntax: "every:N", "reservoir:N", or "rate:N"
+bool ParseSamplingMode(const std::string& a_Sampling, E_SAMPLING_MODE& a_eSamplingMode, size_t& a_Parameter) {
+    size_t l_Colon = a_Sampling.find(':');
+    if ((l_Colon == std::string::npos) || (l_Colon + 1 == a_Sampling.size()) ||
+        (a_Sampling.find_first_not_of("0123456789", l_Colon + 1) != std::string::npos)) {
+        return false;
+    } // if
+
+    std::string l_Mode = a_Sampling.substr(0, l_Colon);
+    if (l_Mode == "every") {
+        a_eSamplingMode = SAMPLING_MODE_EVERY;
+    } else if (l_Mode == "reservoir") {
+        a_eSamplingMode = SAMPLING_MODE_RESERVOIR;
+    } else if (l_Mode == "rate") {
+        a_eSamplingMode = SAMPLING_MODE_RATE;
+    } else {
+        return false;
+    } // else
+
+    a_Parameter = std::stoul(a_Sampling.substr(l_Colon + 1));
+    return (a_Parameter != 0);
+}
+
+// The command line options "--sample" and "--sample-interval", shared by all tools printing frames
+typedef struct {
+    E_SAMPLING_MODE m_eSamplingMode;
+    size_t m_Parameter;
+    std::chrono::milliseconds m_Interval;
+} SamplingOptions;
+
+void AddSamplingOptions(boost::program_options::options_description& a_Description) {
+    a_Description.add_options()
+        ("sample",    boost::program_options::value<std::string>(),
+                      "print a sample of the frames only:\n"
+                      "every:N     every Nth frame\n"
+                      "reservoir:N N random frames per interval\n"
+                      "rate:N      at most N frames per second")
+        ("sample-interval", boost::program_options::value<unsigned int>()->default_value(1000),
+                      "sampling interval in ms: reservoir and summary")
+    ;
+}
+
+// Returns false if "--sample" is malformed. Without "--sample", the mode is SAMPLING_MODE_NONE.
+bool ParseSamplingOptions(const boost::program_options::variables_map& a_VariablesMap, SamplingOptions& a_SamplingOptions) {
+    a_SamplingOptions.m_eSamplingMode = SAMPLING_MODE_NONE;
+    a_SamplingOptions.m_Parameter = 0;
+    a_SamplingOptions.m_Interval = std::chrono::milliseconds(std::max(1u, a_VariablesMap["sample-interval"].as<unsigned int>()));
+    if (!a_VariablesMap.count("sample")) {
+        return true;
+    } // if
+
+    return ParseSamplingMode(a_VariablesMap["sample"].as<std::string>(), a_SamplingOptions.m_eSamplingMode, a_SamplingOptions.m_Parameter);
+}
+
+class FrameSampler {
+public:
+    typedef std::function<void(bool a_bWasSent, bool a_bInvalid, const FrameTimestamp& a_FrameTimestamp, const std::vector<unsigned char>& a_Buffer)> FrameCallback;
+
+    // CTOR: admitted frames are handed to the callback. Suppressed frames are counted and reported to STDERR once per interval.
+    FrameSampler(boost::asio::io_service& a_IoService, E_SAMPLING_MODE a_eSamplingMode, size_t a_Parameter, std::chrono::milliseconds a_Interval,
+                 FrameCallback a_FrameCallback):
+        m_eSamplingMode(a_eSamplingMode), m_Parameter(a_Parameter), m_Interval(a_Interval), m_FrameCallback(a_FrameCallback),
+        m_IntervalTimer(a_IoService), m_NbrOfFrames(0), m_NbrOfSuppressed(0), m_RandomEngine(std::random_device()()),
+        m_Tokens(double(a_Parameter)), m_LastRefill(std::chrono::steady_clock::now()) {
+        if (m_eSamplingMode == SAMPLING_MODE_RESERVOIR) {
+            m_Reservoir.reserve(m_Parameter);
+        } // if
+
+        if (m_eSamplingMode != SAMPLING_MODE_NONE) {
+            StartIntervalTimer();
+        } // if
+    }
+
+    // Decide before the frame is copied or formatted
+    void OnData(const HdlcdPacketData& a_PacketData, const FrameTimestamp& a_FrameTimestamp) {
+        ++m_NbrOfFrames;
+        switch (m_eSamplingMode) {
+        case SAMPLING_MODE_EVERY:
+            if ((m_NbrOfFrames % m_Parameter) == 0) {
+                m_FrameCallback(a_PacketData.GetWasSent(), a_PacketData.GetInvalid(), a_FrameTimestamp, a_PacketData.GetData());
+            } else {
+                ++m_NbrOfSuppressed;
+            } // else
+            break;
+        case SAMPLING_MODE_RESERVOIR:
+            // Algorithm R: after n frames, each of them is kept with probability N/n. Only kept frames are copied.
+            if (m_Reservoir.size() < m_Parameter) {
+                m_Reservoir.push_back(ReservoirEntry());
+                Store(m_Reservoir.back(), a_PacketData, a_FrameTimestamp);
+            } else {
+                size_t l_Index = std::uniform_int_distribution<size_t>(0, m_NbrOfFrames - 1)(m_RandomEngine);
+                if (l_Index < m_Parameter) {
+                    Store(m_Reservoir[l_Index], a_PacketData, a_FrameTimestamp);
+                } // if
+            } // else
+            break;
+        case SAMPLING_MODE_RATE: {
+            // Token bucket, refilled based on the arrival time
+            auto l_Elapsed = (a_FrameTimestamp.GetSteady() - m_LastRefill);
+            if (l_Elapsed.count() > 0) {
+                m_Tokens = std::min(double(m_Parameter), (m_Tokens + m_Parameter * std::chrono::duration_cast<std::chrono::duration<double>>(l_Elapsed).count()));
+                m_LastRefill = a_FrameTimestamp.GetSteady();
+            } // if
+
+            if (m_Tokens >= 1.0) {
+                m_Tokens -= 1.0;
+                m_FrameCallback(a_PacketData.GetWasSent(), a_PacketData.GetInvalid(), a_FrameTimestamp, a_PacketData.GetData());
+            } else {
+                ++m_NbrOfSuppressed;
+            } // else
+            break;
+        }
+        default:
+            m_FrameCallback(a_PacketData.GetWasSent(), a_PacketData.GetInvalid(), a_FrameTimestamp, a_PacketData.GetData());
+            break;
+        } // switch
+    }
+
+    // Stop the interval timer, e.g., if the connection failed. Otherwise it keeps the io_service running.
+    void Cancel() {
+        m_IntervalTimer.cancel();
+    }
+
+    // Emit the samples of the current interval, e.g., on exit
+    void Flush() {
+        if (m_eSamplingMode == SAMPLING_MODE_RESERVOIR) {
+            // Emit in the order of arrival
+            std::sort(m_Reservoir.begin(), m_Reservoir.end(), [](const ReservoirEntry& a_Lhs, const ReservoirEntry& a_Rhs) {
+                return (a_Lhs.m_SequenceNbr < a_Rhs.m_SequenceNbr);
+            });
+
+            for (auto it = m_Reservoir.begin(); it != m_Reservoir.end(); ++it) {
+                m_FrameCallback(it->m_bWasSent, it->m_bInvalid, it->m_FrameTimestamp, it->m_Buffer);
+            } // for
+
+            m_NbrOfSuppressed = (m_NbrOfFrames - m_Reservoir.size());
+            m_Reservoir.clear();
+            m_NbrOfFrames = 0;
+        } // if
+
+        if (m_NbrOfSuppressed) {
+            std::cerr << "Sampling: " << m_NbrOfSuppressed << " frames suppressed" << std::endl;
+            m_NbrOfSuppressed = 0;
+        } // if
+    }
+
+private:
+    // Types
+    struct ReservoirEntry {
+        uint64_t m_SequenceNbr;
+        bool m_bWasSent;
+        bool m_bInvalid;
+        FrameTimestamp m_FrameTimestamp;
+        std::vector<unsigned char> m_Buffer;
+    };
+
+    // Helpers
+    void Store(ReservoirEntry& a_ReservoirEntry, const HdlcdPacketData& a_PacketData, const FrameTimestamp& a_FrameTimestamp) {
+        a_ReservoirEntry.m_SequenceNbr = m_NbrOfFrames;
+        a_ReservoirEntry.m_bWasSent = a_PacketData.GetWasSent();
+        a_ReservoirEntry.m_bInvalid = a_PacketData.GetInvalid();
+        a_ReservoirEntry.m_FrameTimestamp = a_FrameTimestamp;
+        a_ReservoirEntry.m_Buffer.assign(a_PacketData.GetData().begin(), a_PacketData.GetData().end());
+    }
+
+    void StartIntervalTimer() {
+        m_IntervalTimer.expires_from_now(m_Interval);
+        m_IntervalTimer.async_wait([this](const boost::system::error_code& a_ErrorCode) {
+            if (!a_ErrorCode) {
+                Flush();
+                StartIntervalTimer();
+            } // if
+        });
+    }
+
+    // Members
+    E_SAMPLING_MODE m_eSamplingMode;
+    size_t m_Parameter;
+    std::chrono::milliseconds m_Interval;
+    FrameCallback m_FrameCallback;
+    boost::asio::steady_timer m_IntervalTimer;
+    uint64_t m_NbrOfFrames;
+    uint64_t m_NbrOfSuppressed;
+
+    // Reservoir sampling
+    std::vector<ReservoirEntry> m_Reservoir;
+    std::minstd_rand m_RandomEngine;
+
+    // Token bucket
+    double m_Tokens;
+    std::chrono::steady_clock::time_point m_LastRefill;
+};
+
+// NULL if no sampling was requested
+std::unique_ptr<FrameSampler> CreateFrameSampler(boost::asio::io_service& a_IoService, const SamplingOptions& a_SamplingOptions,
+                                                 FrameSampler::FrameCallback a_FrameCallback) {
+    std::unique_ptr<FrameSampler> l_FrameSampler;
+    if (a_SamplingOptions.m_eSamplingMode != SAMPLING_MODE_NONE) {
+        l_FrameSampler.reset(new FrameSampler(a_IoService, a_SamplingOptions.m_eSamplingMode, a_SamplingOptions.m_Parameter,
+                                              a_SamplingOptions.m_Interval, a_FrameCallback));
+    } // if
+
+    return l_FrameSampler;
+}
+
+#endif // FRAME_SAMPLER_H
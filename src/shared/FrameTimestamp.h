@@ -0,0 +1,121 @@
+/**
+ * \file FrameTimestamp.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FRAME_TIMESTAMP_H
+#define FRAME_TIMESTAMP_H
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdint>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+class FrameTimestamp {
+public:
+    // CTOR
+    FrameTimestamp(): m_Microseconds(0) {
+    }
+
+    // Take a stamp as soon as a frame arrives. It is based on the monotonic clock, jumps of the wall clock do not affect intervals.
+    static FrameTimestamp Now() {
+        FrameTimestamp l_FrameTimestamp;
+        l_FrameTimestamp.m_Steady = std::chrono::steady_clock::now();
+        Anchor& l_Anchor = GetAnchor();
+        if ((l_FrameTimestamp.m_Steady - l_Anchor.m_Steady) >= std::chrono::seconds(E_REANCHOR_INTERVAL)) {
+            // Follow the wall clock, e.g., if it is adjusted by NTP, instead of drifting away from it
+            l_Anchor = Anchor();
+        } // if
+
+        l_FrameTimestamp.m_Microseconds = (l_Anchor.m_Microseconds +
+                                           std::chrono::duration_cast<std::chrono::microseconds>(l_FrameTimestamp.m_Steady - l_Anchor.m_Steady).count());
+        return l_FrameTimestamp;
+    }
+
+    // A stamp restored from its UTC part, e.g., read from a ring buffer. The monotonic part is not available.
+    static FrameTimestamp FromMicroseconds(int64_t a_Microseconds) {
+        FrameTimestamp l_FrameTimestamp;
+        l_FrameTimestamp.m_Microseconds = a_Microseconds;
+        return l_FrameTimestamp;
+    }
+
+    const std::chrono::steady_clock::time_point& GetSteady() const {
+        return m_Steady;
+    }
+
+    // UTC, derived from an anchor that is renewed periodically
+    boost::posix_time::ptime GetUtc() const {
+        return (GetEpoch() + boost::posix_time::microseconds(m_Microseconds));
+    }
+
+    // Microseconds since the epoch, UTC
+    int64_t GetMicroseconds() const {
+        return m_Microseconds;
+    }
+
+private:
+    // Constants
+    enum {
+        E_REANCHOR_INTERVAL = 60 // Seconds
+    };
+
+    // Types
+    struct Anchor {
+        Anchor(): m_Steady(std::chrono::steady_clock::now()),
+                  m_Microseconds((boost::posix_time::microsec_clock::universal_time() - GetEpoch()).total_microseconds()) {
+        }
+
+        std::chrono::steady_clock::time_point m_Steady;
+        int64_t m_Microseconds;
+    };
+
+    // Helpers
+    static Anchor& GetAnchor() {
+        // One per thread, thus renewing it requires no locking
+        static thread_local Anchor s_Anchor;
+        return s_Anchor;
+    }
+
+    static const boost::posix_time::ptime& GetEpoch() {
+        static const boost::posix_time::ptime s_Epoch(boost::gregorian::date(1970, 1, 1));
+        return s_Epoch;
+    }
+
+    // Members
+    std::chrono::steady_clock::time_point m_Steady;
+    int64_t m_Microseconds;
+};
+
+void PrintFrameTimestamp(std::ostream& a_OutputStream, const FrameTimestamp& a_FrameTimestamp) {
+    // Example: 2016-02-19 21:59:07.719123
+    boost::posix_time::ptime l_Utc(a_FrameTimestamp.GetUtc());
+    auto l_Date(l_Utc.date());
+    auto l_DayTime(l_Utc.time_of_day());
+    a_OutputStream << std::dec << std::setfill('0')
+                   << std::setw(4) << l_Date.year() << "-"
+                   << std::setw(2) << (int)l_Date.month() << "-"
+                   << std::setw(2) << l_Date.day() << " "
+                   << std::setw(2) << l_DayTime.hours() << ":"
+                   << std::setw(2) << l_DayTime.minutes() << ":"
+                   << std::setw(2) << l_DayTime.seconds() << "."
+                   << std::setw(6) << (l_DayTime.total_microseconds() % 1000000) << " ";
+}
+
+#endif // FRAME_TIMESTAMP_H
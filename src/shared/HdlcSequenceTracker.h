@@ -0,0 +1,139 @@
+/**
+ * \file HdlcSequenceTracker.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HDLC_SEQUENCE_TRACKER_H
+#define HDLC_SEQUENCE_TRACKER_H
+
+#include <algorithm>
+
+// Frames of RX_HDLC sessions are delivered unescaped as address, control, information, and FCS. The control field is modulo 8.
+enum {
+    HDLC_HEADER_SIZE = 2,
+    HDLC_FCS_SIZE    = 2
+};
+
+typedef enum {
+    HDLC_FRAME_TYPE_I,
+    HDLC_FRAME_TYPE_S,
+    HDLC_FRAME_TYPE_UI,
+    HDLC_FRAME_TYPE_U  // All U-frames other than UI, e.g., SABM, UA, or DISC: they reset the sequence numbers
+} E_HDLC_FRAME_TYPE;
+
+E_HDLC_FRAME_TYPE GetHdlcFrameType(unsigned char a_Control) {
+    if ((a_Control & 0x01) == 0x00) {
+        return HDLC_FRAME_TYPE_I;
+    } // if
+
+    if ((a_Control & 0x03) == 0x01) {
+        return HDLC_FRAME_TYPE_S;
+    } // if
+
+    // The P/F bit is ignored
+    return (((a_Control & 0xEF) == 0x03) ? HDLC_FRAME_TYPE_UI : HDLC_FRAME_TYPE_U);
+}
+
+unsigned char GetHdlcNs(unsigned char a_Control) {
+    return ((a_Control >> 1) & 0x07);
+}
+
+unsigned char GetHdlcNr(unsigned char a_Control) {
+    return ((a_Control >> 5) & 0x07);
+}
+
+typedef enum {
+    HDLC_SEQUENCE_IN_SEQUENCE, // The expected N(S), or the first frame observed
+    HDLC_SEQUENCE_GAP,         // N(S) ahead of the expected one
+    HDLC_SEQUENCE_REPEATED     // N(S) sent before but not yet acknowledged via N(R) by the peer
+} E_HDLC_SEQUENCE;
+
+// The N(S) / N(R) state of the I-frames of one direction as seen by an observer of the link
+class HdlcSequenceTracker {
+public:
+    // CTOR
+    HdlcSequenceTracker() {
+        Reset();
+    }
+
+    void Reset() {
+        m_bSynchronized = false;
+        m_ExpectedNs = 0;
+        m_NbrOfUnacknowledged = 0;
+    }
+
+    E_HDLC_SEQUENCE Check(unsigned char a_Ns) const {
+        if ((!m_bSynchronized) || (a_Ns == m_ExpectedNs)) {
+            return HDLC_SEQUENCE_IN_SEQUENCE;
+        } // if
+
+        if (((m_ExpectedNs - a_Ns) & 0x07) <= m_NbrOfUnacknowledged) {
+            return HDLC_SEQUENCE_REPEATED;
+        } // if
+
+        return HDLC_SEQUENCE_GAP;
+    }
+
+    // Take a new frame in sequence or after a gap, the expected N(S) never moves backwards. Returns the number of missing frames.
+    unsigned int Advance(unsigned char a_Ns) {
+        unsigned int l_NbrOfMissing = (m_bSynchronized ? ((a_Ns - m_ExpectedNs) & 0x07) : 0);
+        m_bSynchronized = true;
+        m_ExpectedNs = ((a_Ns + 1) & 0x07);
+        m_NbrOfUnacknowledged = std::min<unsigned int>(7, (m_NbrOfUnacknowledged + l_NbrOfMissing + 1));
+        return l_NbrOfMissing;
+    }
+
+    // N(R) of the peer: all frames up to N(R) - 1 were received. Returns false if N(R) lies outside of the window of frames observed
+    // here but not yet acknowledged, i.e., the peer accepted frames that were not observed. The state is kept in this case.
+    bool Acknowledge(unsigned char a_Nr) {
+        if (!m_bSynchronized) {
+            return true;
+        } // if
+
+        unsigned int l_Behind = ((m_ExpectedNs - a_Nr) & 0x07);
+        if (l_Behind > m_NbrOfUnacknowledged) {
+            return false;
+        } // if
+
+        m_NbrOfUnacknowledged = l_Behind;
+        return true;
+    }
+
+    // Continue with the frame expected by the peer
+    void Resynchronize(unsigned char a_Nr) {
+        m_ExpectedNs = a_Nr;
+        m_NbrOfUnacknowledged = 0;
+    }
+
+    bool IsSynchronized() const {
+        return m_bSynchronized;
+    }
+
+    unsigned char GetExpectedNs() const {
+        return m_ExpectedNs;
+    }
+
+private:
+    // Members
+    bool m_bSynchronized;
+    unsigned char m_ExpectedNs;
+    unsigned int m_NbrOfUnacknowledged;
+};
+
+#endif // HDLC_SEQUENCE_TRACKER_H
@@ -0,0 +1,270 @@
+/**
+ * \file HdlcdAsyncSession.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HDLCD_ASYNC_SESSION_H
+#define HDLCD_ASYNC_SESSION_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include "HdlcdClient.h"
+
+// All operations complete with a single flag: true on success, false on a timeout or if the connection was closed. This allows
+// to use the session from a stackless coroutine (boost::asio::coroutine) that passes itself as completion handler.
+typedef std::function<void(bool)> HdlcdAsyncHandler;
+
+class HdlcdAsyncSession {
+public:
+    // CTOR: completion handlers are always posted to the io_service, never called from within an operation
+    HdlcdAsyncSession(boost::asio::io_service& a_IoService, const std::string& a_SerialPort, const HdlcdSessionDescriptor& a_SessionDescriptor):
+        m_IoService(a_IoService), m_HdlcdClient(a_IoService, a_SerialPort, a_SessionDescriptor), m_Timer(a_IoService), m_bConnected(false),
+        m_bClosed(false), m_bHavePortStatus(false), m_bLockedBySelf(false), m_eWaitType(WAIT_TYPE_NONE), m_WaitId(0),
+        m_ReceivedPayload(NULL), m_NextSendId(0) {
+        m_HdlcdClient.SetOnDataCallback([this](const HdlcdPacketData& a_PacketData) { OnData(a_PacketData); });
+        m_HdlcdClient.SetOnCtrlCallback([this](const HdlcdPacketCtrl& a_PacketCtrl) { OnCtrl(a_PacketCtrl); });
+        m_HdlcdClient.SetOnClosedCallback([this]() { OnClosed(); });
+    }
+
+    void AsyncConnect(boost::asio::ip::tcp::resolver::iterator a_EndpointIterator, HdlcdAsyncHandler a_Handler) {
+        m_HdlcdClient.AsyncConnect(a_EndpointIterator, [this, a_Handler](bool a_bSuccess) {
+            m_bConnected = ((a_bSuccess) && (!m_bClosed));
+            Post(a_Handler, m_bConnected);
+        }); // AsyncConnect
+    }
+
+    // Completes as soon as the packet was handed over to the HDLCd. Multiple sends may be pending, they complete in order.
+    // Without a handler, packets can be pipelined and only the completion of the last one is awaited.
+    void AsyncSend(const std::vector<unsigned char>& a_Payload, HdlcdAsyncHandler a_Handler = HdlcdAsyncHandler()) {
+        if (!m_bConnected) {
+            Post(a_Handler, false);
+            return;
+        } // if
+
+        uint64_t l_SendId = m_NextSendId++;
+        if (a_Handler) {
+            m_PendingSends[l_SendId] = a_Handler;
+        } // if
+
+        if (!m_HdlcdClient.Send(HdlcdPacketData::CreatePacket(a_Payload, true), [this, l_SendId]() { OnSendDone(l_SendId, true); })) {
+            OnSendDone(l_SendId, false);
+        } // if
+    }
+
+    // Acquire or release the lock of the serial port. Completes as soon as the HDLCd reports the requested state.
+    void AsyncLock(bool a_bLock, std::chrono::milliseconds a_Timeout, HdlcdAsyncHandler a_Handler) {
+        if (!StartWait((a_bLock ? WAIT_TYPE_LOCK : WAIT_TYPE_UNLOCK), a_Timeout, a_Handler)) {
+            return;
+        } // if
+
+        if ((m_bHavePortStatus) && (m_bLockedBySelf == a_bLock)) {
+            CompleteWait(true);
+        } else {
+            m_HdlcdClient.Send(HdlcdPacketCtrl::CreatePortStatusRequest(a_bLock));
+        } // else
+    }
+
+    // Receive the payload of the next data packet. Packets that arrived earlier are delivered first, unless discarded.
+    void AsyncReceive(std::vector<unsigned char>& a_Payload, std::chrono::milliseconds a_Timeout, HdlcdAsyncHandler a_Handler) {
+        if (!StartWait(WAIT_TYPE_RECEIVE, a_Timeout, a_Handler)) {
+            return;
+        } // if
+
+        m_ReceivedPayload = &a_Payload;
+        DeliverReceivedPayload();
+    }
+
+    // Drop all payloads received so far, e.g., right before sending a request to receive its reply only
+    void DiscardReceived() {
+        m_ReceivedPayloads.clear();
+    }
+
+    void AsyncWait(std::chrono::milliseconds a_Duration, HdlcdAsyncHandler a_Handler) {
+        StartWait(WAIT_TYPE_TIMER, a_Duration, a_Handler);
+    }
+
+    // Deliver all pending packets, then close. Completes if the connection is closed.
+    void AsyncShutdown(HdlcdAsyncHandler a_Handler) {
+        if (m_bClosed) {
+            Post(a_Handler, true);
+            return;
+        } // if
+
+        m_ShutdownHandler = a_Handler;
+        m_HdlcdClient.Shutdown();
+    }
+
+    // Close immediately: all pending operations fail
+    void Close() {
+        if (!m_bClosed) {
+            m_HdlcdClient.Close();
+            OnClosed();
+        } // if
+    }
+
+    bool GetConnected() const {
+        return m_bConnected;
+    }
+
+private:
+    // Types
+    typedef enum {
+        WAIT_TYPE_NONE,
+        WAIT_TYPE_LOCK,
+        WAIT_TYPE_UNLOCK,
+        WAIT_TYPE_RECEIVE,
+        WAIT_TYPE_TIMER
+    } E_WAIT_TYPE;
+
+    // Helpers
+    void Post(const HdlcdAsyncHandler& a_Handler, bool a_bSuccess) {
+        if (a_Handler) {
+            m_IoService.post(std::bind(a_Handler, a_bSuccess));
+        } // if
+    }
+
+    bool StartWait(E_WAIT_TYPE a_eWaitType, std::chrono::milliseconds a_Timeout, HdlcdAsyncHandler a_Handler) {
+        if (m_eWaitType != WAIT_TYPE_NONE) {
+            throw std::logic_error("only one lock, receive, or wait operation may be pending per session");
+        } // if
+
+        if (m_bClosed) {
+            Post(a_Handler, false);
+            return false;
+        } // if
+
+        m_eWaitType = a_eWaitType;
+        m_WaitHandler = a_Handler;
+        uint64_t l_WaitId = ++m_WaitId;
+        m_Timer.expires_from_now(a_Timeout);
+        m_Timer.async_wait([this, l_WaitId](const boost::system::error_code& a_ErrorCode) {
+            if ((!a_ErrorCode) && (l_WaitId == m_WaitId) && (m_eWaitType != WAIT_TYPE_NONE)) {
+                // A timer completes successfully, all other operations time out
+                CompleteWait(m_eWaitType == WAIT_TYPE_TIMER);
+            } // if
+        });
+
+        return true;
+    }
+
+    void CompleteWait(bool a_bSuccess) {
+        HdlcdAsyncHandler l_Handler;
+        l_Handler.swap(m_WaitHandler);
+        m_eWaitType = WAIT_TYPE_NONE;
+        m_ReceivedPayload = NULL;
+        ++m_WaitId;
+        m_Timer.cancel();
+        Post(l_Handler, a_bSuccess);
+    }
+
+    void DeliverReceivedPayload() {
+        if ((m_eWaitType == WAIT_TYPE_RECEIVE) && (!m_ReceivedPayloads.empty())) {
+            m_ReceivedPayload->swap(m_ReceivedPayloads.front());
+            m_ReceivedPayloads.pop_front();
+            CompleteWait(true);
+        } // if
+    }
+
+    void OnSendDone(uint64_t a_SendId, bool a_bSuccess) {
+        auto l_PendingSend = m_PendingSends.find(a_SendId);
+        if (l_PendingSend != m_PendingSends.end()) {
+            Post(l_PendingSend->second, a_bSuccess);
+            m_PendingSends.erase(l_PendingSend);
+        } // if
+    }
+
+    void OnData(const HdlcdPacketData& a_PacketData) {
+        if (m_ReceivedPayloads.size() >= E_MAX_RECEIVED_PAYLOADS) {
+            m_ReceivedPayloads.pop_front();
+        } // if
+
+        m_ReceivedPayloads.push_back(a_PacketData.GetData());
+        DeliverReceivedPayload();
+    }
+
+    void OnCtrl(const HdlcdPacketCtrl& a_PacketCtrl) {
+        if (a_PacketCtrl.GetPacketType() != HdlcdPacketCtrl::CTRL_TYPE_PORT_STATUS) {
+            return;
+        } // if
+
+        m_bHavePortStatus = true;
+        m_bLockedBySelf = a_PacketCtrl.GetIsLockedBySelf();
+        if (((m_eWaitType == WAIT_TYPE_LOCK) && (m_bLockedBySelf)) || ((m_eWaitType == WAIT_TYPE_UNLOCK) && (!m_bLockedBySelf))) {
+            CompleteWait(true);
+        } // if
+    }
+
+    void OnClosed() {
+        if (m_bClosed) {
+            return;
+        } // if
+
+        m_bClosed = true;
+        m_bConnected = false;
+        if (m_eWaitType != WAIT_TYPE_NONE) {
+            CompleteWait(false);
+        } // if
+
+        for (auto l_PendingSend = m_PendingSends.begin(); l_PendingSend != m_PendingSends.end(); ++l_PendingSend) {
+            Post(l_PendingSend->second, false);
+        } // for
+
+        m_PendingSends.clear();
+        if (m_ShutdownHandler) {
+            Post(m_ShutdownHandler, true);
+            m_ShutdownHandler = HdlcdAsyncHandler();
+        } // if
+    }
+
+    // Constants
+    enum {
+        E_MAX_RECEIVED_PAYLOADS = 1024
+    };
+
+    // Members
+    boost::asio::io_service& m_IoService;
+    HdlcdClient m_HdlcdClient;
+    boost::asio::steady_timer m_Timer;
+    bool m_bConnected;
+    bool m_bClosed;
+    bool m_bHavePortStatus;
+    bool m_bLockedBySelf;
+
+    // The single pending lock, receive, or wait operation
+    E_WAIT_TYPE m_eWaitType;
+    uint64_t m_WaitId;
+    HdlcdAsyncHandler m_WaitHandler;
+    std::vector<unsigned char>* m_ReceivedPayload;
+    std::deque<std::vector<unsigned char>> m_ReceivedPayloads;
+
+    // Pending sends and shutdown
+    uint64_t m_NextSendId;
+    std::map<uint64_t, HdlcdAsyncHandler> m_PendingSends;
+    HdlcdAsyncHandler m_ShutdownHandler;
+};
+
+#endif // HDLCD_ASYNC_SESSION_H
@@ -25,34 +25,42 @@
 #include <iostream>
 #include "HdlcdPacketCtrl.h"
 
-void HdlcdPacketCtrlPrinter(const HdlcdPacketCtrl& a_PacketCtrl) {
-    if (a_PacketCtrl.GetPacketType() == HdlcdPacketCtrl::CTRL_TYPE_PORT_STATUS) {
-        std::cout << "Serial port is: ";
-        if (a_PacketCtrl.GetIsAlive()) {
-            std::cout << "alive,     ";
+void PrintPortStatus(std::ostream& a_OutputStream, bool a_bIsAlive, bool a_bIsLockedBySelf, bool a_bIsLockedByOthers) {
+    a_OutputStream << "Serial port is: ";
+    if (a_bIsAlive) {
+        a_OutputStream << "alive,     ";
+    } else {
+        a_OutputStream << "not alive, ";
+    } // else
+    
+    if ((!a_bIsLockedBySelf) && (!a_bIsLockedByOthers)) {
+        a_OutputStream << "without locks (resumed)" << std::endl;
+    } else {
+        if (a_bIsLockedBySelf) {
+            a_OutputStream << "locked with own lock,    ";
         } else {
-            std::cout << "not alive, ";
+            a_OutputStream << "locked without own lock, ";
         } // else
         
-        if ((!a_PacketCtrl.GetIsLockedBySelf()) && (!a_PacketCtrl.GetIsLockedByOthers())) {
-            std::cout << "without locks (resumed)" << std::endl;
+        if (a_bIsLockedByOthers) {
+            a_OutputStream << "others have locks" << std::endl;
         } else {
-            if (a_PacketCtrl.GetIsLockedBySelf()) {
-                std::cout << "locked with own lock,    ";
-            } else {
-                std::cout << "locked without own lock, ";
-            } // else
-            
-            if (a_PacketCtrl.GetIsLockedByOthers()) {
-                std::cout << "others have locks" << std::endl;
-            } else {
-                std::cout << "no other locks" << std::endl;
-            } // else
+            a_OutputStream << "no other locks" << std::endl;
         } // else
+    } // else
+}
+
+void HdlcdPacketCtrlPrinter(std::ostream& a_OutputStream, const HdlcdPacketCtrl& a_PacketCtrl) {
+    if (a_PacketCtrl.GetPacketType() == HdlcdPacketCtrl::CTRL_TYPE_PORT_STATUS) {
+        PrintPortStatus(a_OutputStream, a_PacketCtrl.GetIsAlive(), a_PacketCtrl.GetIsLockedBySelf(), a_PacketCtrl.GetIsLockedByOthers());
     } else if (a_PacketCtrl.GetPacketType() == HdlcdPacketCtrl::CTRL_TYPE_ECHO) {
-        std::cout << "Received an echo reply packet" << std::endl;
+        a_OutputStream << "Received an echo reply packet" << std::endl;
     } // else if
 }
 
+void HdlcdPacketCtrlPrinter(const HdlcdPacketCtrl& a_PacketCtrl) {
+    HdlcdPacketCtrlPrinter(std::cout, a_PacketCtrl);
+}
+
 
 #endif // HDLCD_PACKET_CTRL_PRINTER_H
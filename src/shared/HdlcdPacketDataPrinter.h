@@ -24,30 +24,67 @@
 
 #include <iostream>
 #include <iomanip>
+#include <vector>
+#include <algorithm>
 #include "HdlcdPacketData.h"
 
-void HdlcdPacketDataPrinter(const HdlcdPacketData& a_PacketData) {
+// Append "xx " per byte. Chunks are formatted in a local buffer, the state of the stream is not touched.
+template<bool Uppercase>
+void HexBytesPrinter(std::ostream& a_OutputStream, const std::vector<unsigned char>& a_Buffer) {
+    static const char s_Digits[] = "0123456789abcdef0123456789ABCDEF";
+    const char* l_Digits = (s_Digits + (Uppercase ? 16 : 0));
+    char l_Chunk[3 * 256];
+    for (size_t l_Offset = 0; l_Offset < a_Buffer.size(); ) {
+        size_t l_Length = std::min<size_t>(256, (a_Buffer.size() - l_Offset));
+        char* l_Output = l_Chunk;
+        for (const unsigned char* l_Input = (a_Buffer.data() + l_Offset); l_Input != (a_Buffer.data() + l_Offset + l_Length); ++l_Input) {
+            *l_Output++ = l_Digits[*l_Input >> 4];
+            *l_Output++ = l_Digits[*l_Input & 0x0F];
+            *l_Output++ = ' ';
+        } // for
+
+        a_OutputStream.write(l_Chunk, (l_Output - l_Chunk));
+        l_Offset += l_Length;
+    } // for
+}
+
+// Specialized on the directions a session delivers: with one direction only, a_bWasSent is a constant and its branches are dropped
+template<bool DeliverSent, bool DeliverRcvd>
+void HdlcdPacketDataHexPrinter(std::ostream& a_OutputStream, bool a_bWasSent, bool a_bInvalid, const std::vector<unsigned char>& a_Buffer) {
     // Print a hexdump of the provided data buffer. It should contain a packet to be printed in one line.
-    if (a_PacketData.GetWasSent()) {
-        std::cout << "<<< Sent: ";
+    static const char s_SentPrefix[] = "<<< Sent: ";
+    static const char s_RcvdPrefix[] = ">>> Rcvd: ";
+    const bool l_bWasSent = (DeliverSent && ((!DeliverRcvd) || a_bWasSent));
+    if (l_bWasSent) {
+        a_OutputStream.write(s_SentPrefix, (sizeof(s_SentPrefix) - 1));
     } else {
-        std::cout << ">>> Rcvd: ";
+        a_OutputStream.write(s_RcvdPrefix, (sizeof(s_RcvdPrefix) - 1));
     } // else
 
-    const std::vector<unsigned char> l_Buffer = a_PacketData.GetData();
-    for (auto it = l_Buffer.begin(); it != l_Buffer.end(); ++it) {
-        std::cout << std::hex << std::setw(2) << std::setfill('0') << int(*it) << " ";
-    } // for
-    
-    if (a_PacketData.GetWasSent() == false) {
-        if (a_PacketData.GetInvalid()) {
-            std::cout << "(BROKEN)";
-        } else {
-            std::cout << "(CRC OK)";
-        } // else
+    HexBytesPrinter<false>(a_OutputStream, a_Buffer);
+    if (!l_bWasSent) {
+        a_OutputStream.write((a_bInvalid ? "(BROKEN)" : "(CRC OK)"), 8);
     } // if
 
-    std::cout << std::endl;
+    a_OutputStream.put('\n');
+    a_OutputStream.flush();
+}
+
+template<class SessionTraits>
+void HdlcdPacketDataHexPrinter(std::ostream& a_OutputStream, bool a_bWasSent, bool a_bInvalid, const std::vector<unsigned char>& a_Buffer) {
+    HdlcdPacketDataHexPrinter<SessionTraits::bDeliverSent, SessionTraits::bDeliverRcvd>(a_OutputStream, a_bWasSent, a_bInvalid, a_Buffer);
+}
+
+void HdlcdPacketDataPrinter(std::ostream& a_OutputStream, bool a_bWasSent, bool a_bInvalid, const std::vector<unsigned char>& a_Buffer) {
+    HdlcdPacketDataHexPrinter<true, true>(a_OutputStream, a_bWasSent, a_bInvalid, a_Buffer);
+}
+
+void HdlcdPacketDataPrinter(std::ostream& a_OutputStream, const HdlcdPacketData& a_PacketData) {
+    HdlcdPacketDataPrinter(a_OutputStream, a_PacketData.GetWasSent(), a_PacketData.GetInvalid(), a_PacketData.GetData());
+}
+
+void HdlcdPacketDataPrinter(const HdlcdPacketData& a_PacketData) {
+    HdlcdPacketDataPrinter(std::cout, a_PacketData);
 }
 
 #endif // HDLCD_PACKET_DATA_PRINTER_H
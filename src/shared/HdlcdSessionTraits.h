@@ -0,0 +1,47 @@
+/**
+ * \file HdlcdSessionTraits.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HDLCD_SESSION_TRAITS_H
+#define HDLCD_SESSION_TRAITS_H
+
+#include "HdlcdSessionDescriptor.h"
+
+// The session of a tool fixed at compile time: the descriptor sent to the HDLCd and the printers are derived from the same constants
+template<E_SESSION_TYPE SessionType, bool DeliverSent, bool DeliverRcvd>
+struct HdlcdSessionTraits {
+    static const E_SESSION_TYPE eSessionType = SessionType;
+    static const bool bDeliverSent = DeliverSent;
+    static const bool bDeliverRcvd = DeliverRcvd;
+
+    static HdlcdSessionDescriptor CreateSessionDescriptor() {
+        if (DeliverSent && DeliverRcvd) {
+            return HdlcdSessionDescriptor(SessionType, (SESSION_FLAGS_DELIVER_SENT | SESSION_FLAGS_DELIVER_RCVD));
+        } else if (DeliverSent) {
+            return HdlcdSessionDescriptor(SessionType, SESSION_FLAGS_DELIVER_SENT);
+        } else if (DeliverRcvd) {
+            return HdlcdSessionDescriptor(SessionType, SESSION_FLAGS_DELIVER_RCVD);
+        } else {
+            return HdlcdSessionDescriptor(SessionType, SESSION_FLAGS_NONE);
+        } // else
+    }
+};
+
+#endif // HDLCD_SESSION_TRAITS_H
@@ -0,0 +1,188 @@
+/**
+ * \file HexParser.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HEX_PARSER_H
+#define HEX_PARSER_H
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstddef>
+
+class HexParser {
+public:
+    // CTOR: each token is a byte of one or two hex digits, optionally prefixed by "0x"
+    HexParser(size_t a_MaxPayloadSize): m_MaxPayloadSize(a_MaxPayloadSize), m_Line(1), m_Column(0) {
+        Reset();
+    }
+
+    // Start a new payload. The capacity of the buffer is kept unless it was moved away. The position in the input is kept.
+    void Reset() {
+        m_Payload.clear();
+        m_Value = 0;
+        m_NbrOfDigits = 0;
+        m_bInToken = false;
+        m_bInvalid = false;
+        m_bTooLarge = false;
+        m_ErrorLine = 0;
+        m_ErrorColumn = 0;
+        m_Error.clear();
+    }
+
+    // Hint to avoid reallocations if the size of the input is known beforehand
+    void Reserve(size_t a_NbrOfBytes) {
+        m_Payload.reserve((a_NbrOfBytes < m_MaxPayloadSize) ? a_NbrOfBytes : m_MaxPayloadSize);
+    }
+
+    // Consume a chunk of a hex dump. Tokens may be split across subsequent chunks.
+    void Parse(const char* a_Begin, const char* a_End) {
+        for (const char* l_Char = a_Begin; l_Char != a_End; ++l_Char) {
+            ++m_Column;
+            if (m_bInvalid) {
+                // The payload is rejected as a whole, only keep track of the position
+                if (*l_Char == '\n') {
+                    ++m_Line;
+                    m_Column = 0;
+                } // if
+
+                continue;
+            } // if
+
+            int l_Digit = HexDigit(*l_Char);
+            if (l_Digit >= 0) {
+                if (m_NbrOfDigits == 2) {
+                    SetInvalid("more than two hex digits in a token");
+                    continue;
+                } // if
+
+                m_Value = ((m_Value << 4) | l_Digit);
+                ++m_NbrOfDigits;
+                m_bInToken = true;
+            } else if ((*l_Char == ' ') || (*l_Char == '\t') || (*l_Char == '\r') || (*l_Char == '\n')) {
+                EndOfToken();
+                if (*l_Char == '\n') {
+                    ++m_Line;
+                    m_Column = 0;
+                } // if
+            } else if (((*l_Char == 'x') || (*l_Char == 'X')) && (m_NbrOfDigits == 1) && (m_Value == 0)) {
+                // Prefix "0x"
+                m_NbrOfDigits = 0;
+            } else {
+                SetInvalid(std::string("invalid character '") + *l_Char + "'");
+            } // else
+        } // for
+    }
+
+    // Complete the last token, e.g., at the end of a line or at the end of the file
+    void Finish() {
+        if (!m_bInvalid) {
+            EndOfToken();
+        } // if
+    }
+
+    bool GetTooLarge() const {
+        return m_bTooLarge;
+    }
+
+    // A malformed token invalidates the whole payload, the position of the first one is reported
+    bool GetInvalid() const {
+        return m_bInvalid;
+    }
+
+    unsigned int GetErrorLine() const {
+        return m_ErrorLine;
+    }
+
+    unsigned int GetErrorColumn() const {
+        return m_ErrorColumn;
+    }
+
+    const std::string& GetError() const {
+        return m_Error;
+    }
+
+    // Example: "line 3, column 7: invalid character 'z'"
+    std::string GetErrorText() const {
+        std::ostringstream l_ErrorText;
+        l_ErrorText << "line " << m_ErrorLine << ", column " << m_ErrorColumn << ": " << m_Error;
+        return l_ErrorText.str();
+    }
+
+    std::vector<unsigned char>& GetPayload() {
+        return m_Payload;
+    }
+
+private:
+    // Helpers
+    static int HexDigit(char a_Char) {
+        if ((a_Char >= '0') && (a_Char <= '9')) {
+            return (a_Char - '0');
+        } else if ((a_Char >= 'a') && (a_Char <= 'f')) {
+            return (a_Char - 'a' + 10);
+        } else if ((a_Char >= 'A') && (a_Char <= 'F')) {
+            return (a_Char - 'A' + 10);
+        } // else if
+
+        return -1;
+    }
+
+    void SetInvalid(const std::string& a_Error) {
+        m_bInvalid = true;
+        m_ErrorLine = m_Line;
+        m_ErrorColumn = m_Column;
+        m_Error = a_Error;
+    }
+
+    void EndOfToken() {
+        if (m_bInToken) {
+            if (m_NbrOfDigits == 0) {
+                SetInvalid("\"0x\" without hex digits");
+                return;
+            } else if (m_Payload.size() < m_MaxPayloadSize) {
+                m_Payload.push_back((unsigned char)m_Value);
+            } else {
+                m_bTooLarge = true;
+            } // else
+
+            m_Value = 0;
+            m_NbrOfDigits = 0;
+            m_bInToken = false;
+        } // if
+    }
+
+    // Members
+    size_t m_MaxPayloadSize;
+    std::vector<unsigned char> m_Payload;
+    unsigned int m_Value;
+    unsigned int m_NbrOfDigits;
+    bool m_bInToken;
+    bool m_bInvalid;
+    bool m_bTooLarge;
+
+    // Position in the input, for error messages
+    unsigned int m_Line;
+    unsigned int m_Column;
+    unsigned int m_ErrorLine;
+    unsigned int m_ErrorColumn;
+    std::string m_Error;
+};
+
+#endif // HEX_PARSER_H
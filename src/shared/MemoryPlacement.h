@@ -0,0 +1,231 @@
+/**
+ * \file MemoryPlacement.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEMORY_PLACEMENT_H
+#define MEMORY_PLACEMENT_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+// Returns the NUMA node to use: either given as a number or as the name of a network interface, e.g., "eth0". -1: no NUMA.
+int ParseNumaNode(const std::string& a_NodeOrInterface) {
+    if ((!a_NodeOrInterface.empty()) && (a_NodeOrInterface.find_first_not_of("0123456789") == std::string::npos)) {
+        return std::stoi(a_NodeOrInterface);
+    } // if
+
+    std::ifstream l_NumaNodeFile(("/sys/class/net/" + a_NodeOrInterface + "/device/numa_node").c_str());
+    int l_NumaNode = -1;
+    if (!(l_NumaNodeFile >> l_NumaNode)) {
+        throw std::runtime_error("cannot determine the NUMA node of network interface " + a_NodeOrInterface);
+    } // if
+
+    // The kernel reports -1 on hosts with a single node
+    return l_NumaNode;
+}
+
+// Restrict the calling thread to the CPUs of a NUMA node and prefer the memory of that node for all later allocations, i.e.,
+// for all buffers touched first by this thread. Threads created afterwards inherit the affinity and the memory policy.
+bool BindThreadToNumaNode(int a_NumaNode) {
+    if (a_NumaNode < 0) {
+        return true;
+    } // if
+
+#if defined(__linux__)
+    // Syntax of the CPU list: "0-7,16-23"
+    std::ifstream l_CpuListFile(("/sys/devices/system/node/node" + std::to_string(a_NumaNode) + "/cpulist").c_str());
+    std::string l_CpuList;
+    if (!std::getline(l_CpuListFile, l_CpuList)) {
+        return false;
+    } // if
+
+    cpu_set_t l_CpuSet;
+    CPU_ZERO(&l_CpuSet);
+    std::stringstream l_Ranges(l_CpuList);
+    std::string l_Range;
+    while (std::getline(l_Ranges, l_Range, ',')) {
+        int l_First = 0;
+        int l_Last = 0;
+        int l_NbrOfFields = sscanf(l_Range.c_str(), "%d-%d", &l_First, &l_Last);
+        if (l_NbrOfFields < 1) {
+            continue;
+        } // if
+
+        if (l_NbrOfFields == 1) {
+            l_Last = l_First;
+        } // if
+
+        for (int l_Cpu = l_First; (l_Cpu <= l_Last) && (l_Cpu < CPU_SETSIZE); ++l_Cpu) {
+            CPU_SET(l_Cpu, &l_CpuSet);
+        } // for
+    } // while
+
+    if ((!CPU_COUNT(&l_CpuSet)) || (pthread_setaffinity_np(pthread_self(), sizeof(l_CpuSet), &l_CpuSet) != 0)) {
+        return false;
+    } // if
+
+#if defined(SYS_set_mempolicy)
+    if (a_NumaNode < 64) {
+        // Without depending on libnuma. Preferred instead of strict binding, as for PlacedBuffer.
+        const int l_MpolPreferred = 1;
+        unsigned long l_NodeMask = (1ul << a_NumaNode);
+        if (::syscall(SYS_set_mempolicy, l_MpolPreferred, &l_NodeMask, (sizeof(l_NodeMask) * 8)) != 0) {
+            std::cerr << "Failed to prefer the memory of NUMA node " << a_NumaNode << ": " << ::strerror(errno) << std::endl;
+        } // if
+    } // if
+#endif
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+// A large buffer, optionally backed by huge pages and placed on a NUMA node. All pages are touched by the constructor.
+class PlacedBuffer {
+public:
+    // CTOR
+    PlacedBuffer(size_t a_Size, bool a_bHugePages = false, int a_NumaNode = -1): m_Data(NULL), m_Size(a_Size), m_MappedSize(0), m_bHugePages(false) {
+#if defined(__linux__)
+        if ((a_bHugePages) || (a_NumaNode >= 0)) {
+            Map(a_bHugePages, a_NumaNode);
+        } // if
+#endif
+        if (!m_Data) {
+            m_Fallback.resize(m_Size);
+            m_Data = m_Fallback.data();
+        } // if
+    }
+
+    // DTOR
+    ~PlacedBuffer() {
+#if defined(__linux__)
+        if (m_MappedSize) {
+            ::munmap(m_Data, m_MappedSize);
+        } // if
+#endif
+    }
+
+    unsigned char* GetData() {
+        return m_Data;
+    }
+
+    const unsigned char* GetData() const {
+        return m_Data;
+    }
+
+    size_t GetSize() const {
+        return m_Size;
+    }
+
+    bool GetHugePages() const {
+        return m_bHugePages;
+    }
+
+private:
+    // Non-copyable
+    PlacedBuffer(const PlacedBuffer&);
+    PlacedBuffer& operator=(const PlacedBuffer&);
+
+#if defined(__linux__)
+    // Helpers
+    static size_t GetHugePageSize() {
+        std::ifstream l_MemInfo("/proc/meminfo");
+        std::string l_Line;
+        while (std::getline(l_MemInfo, l_Line)) {
+            size_t l_KiloBytes = 0;
+            if (sscanf(l_Line.c_str(), "Hugepagesize: %zu kB", &l_KiloBytes) == 1) {
+                return (l_KiloBytes * 1024);
+            } // if
+        } // while
+
+        return (2 * 1024 * 1024);
+    }
+
+    void Map(bool a_bHugePages, int a_NumaNode) {
+        void* l_Data = MAP_FAILED;
+        if (a_bHugePages) {
+            // Reserved huge pages first, the length must be a multiple of their size
+            size_t l_HugePageSize = GetHugePageSize();
+            m_MappedSize = (((m_Size + l_HugePageSize - 1) / l_HugePageSize) * l_HugePageSize);
+            l_Data = ::mmap(NULL, m_MappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (l_Data != MAP_FAILED) {
+                m_bHugePages = true;
+            } else {
+                std::cerr << "No reserved huge pages available for " << m_Size << " bytes, falling back to transparent huge pages" << std::endl;
+            } // else
+        } // if
+
+        if (l_Data == MAP_FAILED) {
+            m_MappedSize = m_Size;
+            l_Data = ::mmap(NULL, m_MappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (l_Data == MAP_FAILED) {
+                m_MappedSize = 0;
+                return;
+            } // if
+
+#if defined(MADV_HUGEPAGE)
+            if (a_bHugePages) {
+                ::madvise(l_Data, m_MappedSize, MADV_HUGEPAGE);
+            } // if
+#endif
+        } // if
+
+#if defined(SYS_mbind)
+        if ((a_NumaNode >= 0) && (a_NumaNode < 64)) {
+            // Without depending on libnuma. Preferred instead of strict binding: no SIGBUS if the node runs out of memory.
+            const int l_MpolPreferred = 1;
+            unsigned long l_NodeMask = (1ul << a_NumaNode);
+            if (::syscall(SYS_mbind, l_Data, m_MappedSize, l_MpolPreferred, &l_NodeMask, (sizeof(l_NodeMask) * 8), 0) != 0) {
+                std::cerr << "Failed to place " << m_Size << " bytes on NUMA node " << a_NumaNode << ": " << ::strerror(errno) << std::endl;
+            } // if
+        } // if
+#endif
+
+        // Fault in all pages now, not while capturing
+        m_Data = static_cast<unsigned char*>(l_Data);
+        ::memset(m_Data, 0x00, m_MappedSize);
+    }
+#endif
+
+    // Members
+    unsigned char* m_Data;
+    size_t m_Size;
+    size_t m_MappedSize;
+    bool m_bHugePages;
+    std::vector<unsigned char> m_Fallback;
+};
+
+#endif // MEMORY_PLACEMENT_H
@@ -0,0 +1,534 @@
+/**
+ * \file OutputSink.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include "Config.h"
+#include "StageProfiler.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <cstdint>
+#include <stdexcept>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/regex.hpp>
+#ifdef HDLCD_TOOLS_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+class OutputSink: private std::streambuf {
+public:
+    // CTOR: a rotate size of 0 or a rotate interval of 0 disables the respective rotation criterion
+    OutputSink(const std::string& a_FileName, bool a_bCompress, uint64_t a_RotateSize = 0,
+               std::chrono::seconds a_RotateInterval = std::chrono::seconds(0),
+               std::chrono::milliseconds a_FlushInterval = std::chrono::milliseconds(1000)):
+        m_OutputStream(this), m_FileName(a_FileName), m_bCompress(a_bCompress), m_RotateSize(a_RotateSize),
+        m_RotateInterval(a_RotateInterval), m_FlushInterval(a_FlushInterval), m_FrontComplete(0), m_bDropping(false),
+        m_NbrOfDroppedBytes(0), m_bStopped(false), m_bWriteError(false), m_File(NULL), m_FileBytes(0), m_FileCounter(0),
+        m_bPreOpenRequested(false), m_PreOpenedFile(NULL), m_MaxFiles(0), m_MaxAge(0), m_bHousekeepingStopped(false) {
+#ifndef HDLCD_TOOLS_HAVE_ZLIB
+        if (m_bCompress) {
+            throw std::runtime_error("output compression is not supported by this build (zlib missing)");
+        } // if
+#endif
+        // All files of this run share the start time, thus the name of the next file is known in advance
+        m_RunTimestamp = boost::posix_time::to_iso_string(boost::posix_time::second_clock::universal_time()).replace(8, 1, "-");
+        m_PutArea.resize(E_PUT_AREA_SIZE);
+        setp(m_PutArea.data(), m_PutArea.data() + m_PutArea.size());
+        m_FrontBuffer.reserve(E_BLOCK_SIZE);
+        m_BackBuffer.reserve(E_BLOCK_SIZE);
+        m_CompressBuffer.resize(E_BLOCK_SIZE);
+
+        // Open the first file on the calling thread to report errors early
+        OpenFile(m_FileCounter);
+        RequestPreOpen();
+        m_HousekeepingThread = std::thread([this](){ HousekeepingLoop(); });
+        m_WriterThread = std::thread([this](){ WriterLoop(); });
+    }
+
+    // DTOR
+    ~OutputSink() {
+        Stop();
+    }
+
+    // Retention of rotated files: a value of 0 disables the respective criterion. Call before the first rotation.
+    void SetRetention(unsigned int a_MaxFiles, std::chrono::seconds a_MaxAge) {
+        std::lock_guard<std::mutex> l_Lock(m_HousekeepingMutex);
+        m_MaxFiles = a_MaxFiles;
+        m_MaxAge = a_MaxAge;
+    }
+
+    // The stream to be filled by exactly one thread, e.g., the network thread or the output thread of the formatting pipeline
+    std::ostream& GetStream() {
+        return m_OutputStream;
+    }
+
+    // Hand over all pending output, finish the current file, and terminate the background threads
+    void Stop() {
+        HandOver(true);
+        {
+            std::lock_guard<std::mutex> l_Lock(m_Mutex);
+            if (m_bStopped) {
+                return;
+            } // if
+
+            m_bStopped = true;
+        }
+
+        m_Condition.notify_one();
+        m_WriterThread.join();
+        if (m_NbrOfDroppedBytes) {
+            std::cerr << "Output to " << m_FileName << " was too slow, dropped " << m_NbrOfDroppedBytes << " bytes" << std::endl;
+        } // if
+
+        {
+            std::lock_guard<std::mutex> l_Lock(m_HousekeepingMutex);
+            m_bHousekeepingStopped = true;
+        }
+
+        m_HousekeepingCondition.notify_one();
+        m_HousekeepingThread.join();
+    }
+
+private:
+    // std::streambuf interface: never performs I/O, only copies into the front buffer
+    int_type overflow(int_type a_Char) {
+        HandOver(false);
+        if (!traits_type::eq_int_type(a_Char, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(a_Char);
+            pbump(1);
+        } // if
+
+        return traits_type::not_eof(a_Char);
+    }
+
+    int sync() {
+        // Called for each std::endl: publish the complete line, the writer thread decides when to touch the disk
+        HandOver(true);
+        return 0;
+    }
+
+    // Helpers
+    void HandOver(bool a_bLineComplete) {
+        size_t l_Size = (pptr() - pbase());
+        if (l_Size) {
+            bool l_bNotify = false;
+            {
+                std::lock_guard<std::mutex> l_Lock(m_Mutex);
+                if ((!m_bDropping) && ((m_FrontBuffer.size() + l_Size) > E_MAX_BACKLOG_SIZE)) {
+                    // The writer fell behind. Do not stall the producer, but drop the whole current line.
+                    m_NbrOfDroppedBytes += (m_FrontBuffer.size() - m_FrontComplete);
+                    m_FrontBuffer.resize(m_FrontComplete);
+                    m_bDropping = true;
+                } // if
+
+                if (m_bDropping) {
+                    m_NbrOfDroppedBytes += l_Size;
+                    m_bDropping = (!a_bLineComplete);
+                } else {
+                    m_FrontBuffer.insert(m_FrontBuffer.end(), pbase(), pptr());
+                    if (a_bLineComplete) {
+                        // Files are only switched at this position, i.e., between two frames
+                        m_FrontComplete = m_FrontBuffer.size();
+                    } // if
+                } // else
+
+                l_bNotify = (m_FrontComplete >= E_BLOCK_SIZE);
+            }
+
+            setp(m_PutArea.data(), m_PutArea.data() + m_PutArea.size());
+            if (l_bNotify) {
+                m_Condition.notify_one();
+            } // if
+        } // if
+    }
+
+    void WriterLoop() {
+        STAGE_PROFILER_THREAD("writer");
+        auto l_NextFlush = (std::chrono::steady_clock::now() + m_FlushInterval);
+        std::unique_lock<std::mutex> l_Lock(m_Mutex);
+        while (true) {
+            m_Condition.wait_until(l_Lock, l_NextFlush, [this](){ return (m_bStopped || (m_FrontComplete >= E_BLOCK_SIZE)); });
+            m_FrontBuffer.swap(m_BackBuffer);
+            bool l_bStopped = m_bStopped;
+            if ((!l_bStopped) && (m_FrontComplete < m_BackBuffer.size())) {
+                // Hold back the tail of an incomplete line, thus the back buffer always ends on a line boundary
+                m_FrontBuffer.assign(m_BackBuffer.begin() + m_FrontComplete, m_BackBuffer.end());
+                m_BackBuffer.resize(m_FrontComplete);
+            } // if
+
+            m_FrontComplete = 0;
+            l_Lock.unlock();
+
+            // Perform all I/O without holding the lock
+            WriteBlock(m_BackBuffer.data(), m_BackBuffer.size());
+            auto l_Now = std::chrono::steady_clock::now();
+            if ((!l_bStopped) && (RotationDue(l_Now))) {
+                // Files are only switched between two lines
+                Rotate(l_Now);
+            } // if
+
+            m_BackBuffer.clear();
+            if (l_bStopped) {
+                HandOverToHousekeeping(FinishFile());
+                return;
+            } else if (l_Now >= l_NextFlush) {
+                // Keep the file readable up to this point even if we crash later on
+                SyncFlush();
+                l_NextFlush = (l_Now + m_FlushInterval);
+            } // else if
+
+            l_Lock.lock();
+        } // while
+    }
+
+    bool RotationDue(std::chrono::steady_clock::time_point a_Now) const {
+        if ((m_RotateSize) && (m_FileBytes >= m_RotateSize)) {
+            return true;
+        } // if
+
+        return ((m_RotateInterval.count()) && ((a_Now - m_FileOpened) >= m_RotateInterval));
+    }
+
+    void Rotate(std::chrono::steady_clock::time_point a_Now) {
+        HandOverToHousekeeping(FinishFile());
+        ++m_FileCounter;
+        std::FILE* l_PreOpenedFile = NULL;
+        {
+            // Take the prepared file, or cancel the pending request if the housekeeping thread did not get to it yet
+            std::lock_guard<std::mutex> l_Lock(m_HousekeepingMutex);
+            std::swap(l_PreOpenedFile, m_PreOpenedFile);
+            m_bPreOpenRequested = false;
+        }
+
+        try {
+            OpenFile(m_FileCounter, l_PreOpenedFile);
+            RequestPreOpen();
+        } catch (std::exception& a_Error) {
+            // Keep on draining the front buffer, the output is lost until the next attempt
+            std::cerr << "Exception: " << a_Error.what() << std::endl;
+            m_FileBytes = m_RotateSize;
+            m_FileOpened = a_Now;
+        } // catch
+    }
+
+    bool IsRotating() const {
+        return ((m_RotateSize) || (m_RotateInterval.count()));
+    }
+
+    std::string GetFileName(unsigned int a_FileCounter) const {
+        if (!IsRotating()) {
+            return m_FileName;
+        } // if
+
+        // Example: capture.log.20161013-215907.0003.gz
+        std::ostringstream l_FileName;
+        l_FileName << m_FileName << "." << m_RunTimestamp << "." << std::setw(4) << std::setfill('0') << a_FileCounter;
+        if (m_bCompress) {
+            l_FileName << ".gz";
+        } // if
+
+        return l_FileName.str();
+    }
+
+    void OpenFile(unsigned int a_FileCounter, std::FILE* a_PreOpenedFile = NULL) {
+        if (a_PreOpenedFile) {
+            m_File = a_PreOpenedFile;
+        } else {
+            // Nothing prepared yet, e.g., the housekeeping thread was slow. Open it synchronously.
+            m_File = std::fopen(GetFileName(a_FileCounter).c_str(), "wb");
+            if (!m_File) {
+                throw std::runtime_error("failed to open output file " + GetFileName(a_FileCounter));
+            } // if
+        } // else
+
+        m_FileBytes = 0;
+        m_FileOpened = std::chrono::steady_clock::now();
+#ifdef HDLCD_TOOLS_HAVE_ZLIB
+        if (m_bCompress) {
+            // Window bits 15 plus 16: produce a gzip stream instead of a raw zlib stream
+            m_ZStream.zalloc = Z_NULL;
+            m_ZStream.zfree  = Z_NULL;
+            m_ZStream.opaque = Z_NULL;
+            if (deflateInit2(&m_ZStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                throw std::runtime_error("failed to initialize the gzip compressor");
+            } // if
+        } // if
+#endif
+    }
+
+    std::FILE* FinishFile() {
+        std::FILE* l_File = m_File;
+        if (l_File) {
+#ifdef HDLCD_TOOLS_HAVE_ZLIB
+            if (m_bCompress) {
+                Deflate(NULL, 0, Z_FINISH);
+                deflateEnd(&m_ZStream);
+            } // if
+#endif
+            m_File = NULL;
+        } // if
+
+        return l_File;
+    }
+
+    void WriteBlock(const char* a_Data, size_t a_Size) {
+        if ((!m_File) || (!a_Size)) {
+            return;
+        } // if
+
+        STAGE_PROFILER_SCOPE(PROFILER_STAGE_WRITE);
+#ifdef HDLCD_TOOLS_HAVE_ZLIB
+        if (m_bCompress) {
+            Deflate(a_Data, a_Size, Z_NO_FLUSH);
+            return;
+        } // if
+#endif
+        WriteFile(a_Data, a_Size);
+    }
+
+    void SyncFlush() {
+        if (!m_File) {
+            return;
+        } // if
+
+#ifdef HDLCD_TOOLS_HAVE_ZLIB
+        if (m_bCompress) {
+            Deflate(NULL, 0, Z_SYNC_FLUSH);
+        } // if
+#endif
+        std::fflush(m_File);
+    }
+
+#ifdef HDLCD_TOOLS_HAVE_ZLIB
+    void Deflate(const char* a_Data, size_t a_Size, int a_FlushMode) {
+        m_ZStream.next_in  = (Bytef*)a_Data;
+        m_ZStream.avail_in = a_Size;
+        do {
+            m_ZStream.next_out  = (Bytef*)m_CompressBuffer.data();
+            m_ZStream.avail_out = m_CompressBuffer.size();
+            deflate(&m_ZStream, a_FlushMode);
+            WriteFile(m_CompressBuffer.data(), (m_CompressBuffer.size() - m_ZStream.avail_out));
+        } while (m_ZStream.avail_out == 0);
+    }
+#endif
+
+    void WriteFile(const char* a_Data, size_t a_Size) {
+        if ((m_File) && (std::fwrite(a_Data, 1, a_Size, m_File) == a_Size)) {
+            m_FileBytes += a_Size;
+        } else if (!m_bWriteError) {
+            // Report only once, e.g., if the disk is full
+            std::cerr << "Failed to write to output file " << m_FileName << std::endl;
+            m_bWriteError = true;
+        } // else if
+    }
+
+    // Housekeeping: everything that may take long but is not required to continue writing
+    void RequestPreOpen() {
+        if (IsRotating()) {
+            {
+                std::lock_guard<std::mutex> l_Lock(m_HousekeepingMutex);
+                m_bPreOpenRequested = true;
+                m_PreOpenCounter = (m_FileCounter + 1);
+                m_CurrentFileName = GetFileName(m_FileCounter);
+            }
+
+            m_HousekeepingCondition.notify_one();
+        } // if
+    }
+
+    void HandOverToHousekeeping(std::FILE* a_File) {
+        if (a_File) {
+            {
+                std::lock_guard<std::mutex> l_Lock(m_HousekeepingMutex);
+                m_FilesToClose.push_back(a_File);
+            }
+
+            m_HousekeepingCondition.notify_one();
+        } // if
+    }
+
+    void HousekeepingLoop() {
+        std::unique_lock<std::mutex> l_Lock(m_HousekeepingMutex);
+        while (true) {
+            m_HousekeepingCondition.wait(l_Lock, [this](){ return (m_bHousekeepingStopped || m_bPreOpenRequested || (!m_FilesToClose.empty())); });
+            while (!m_FilesToClose.empty()) {
+                std::FILE* l_File = m_FilesToClose.front();
+                m_FilesToClose.pop_front();
+                l_Lock.unlock();
+                CloseFile(l_File);
+                ApplyRetention();
+                l_Lock.lock();
+            } // while
+
+            if (m_bHousekeepingStopped) {
+                if (m_PreOpenedFile) {
+                    // Prepared but never used: do not leave an empty file behind
+                    CloseFile(m_PreOpenedFile);
+                    m_PreOpenedFile = NULL;
+                    boost::system::error_code l_ErrorCode;
+                    boost::filesystem::remove(m_PreOpenedFileName, l_ErrorCode);
+                } // if
+
+                return;
+            } // if
+
+            if (m_bPreOpenRequested) {
+                // Keep the lock: the writer must not open the same file synchronously in the meantime
+                m_bPreOpenRequested = false;
+                m_PreOpenedFileName = GetFileName(m_PreOpenCounter);
+                m_PreOpenedFile = std::fopen(m_PreOpenedFileName.c_str(), "wb");
+            } // if
+        } // while
+    }
+
+    static void CloseFile(std::FILE* a_File) {
+        std::fflush(a_File);
+#ifdef _WIN32
+        _commit(_fileno(a_File));
+#else
+        fsync(fileno(a_File));
+#endif
+        std::fclose(a_File);
+    }
+
+    void ApplyRetention() {
+        unsigned int l_MaxFiles;
+        std::chrono::seconds l_MaxAge;
+        std::string l_CurrentFileName, l_PreOpenedFileName;
+        {
+            std::lock_guard<std::mutex> l_Lock(m_HousekeepingMutex);
+            l_MaxFiles = m_MaxFiles;
+            l_MaxAge = m_MaxAge;
+            l_CurrentFileName = m_CurrentFileName;
+            l_PreOpenedFileName = m_PreOpenedFileName;
+        }
+
+        if ((!IsRotating()) || ((!l_MaxFiles) && (!l_MaxAge.count()))) {
+            return;
+        } // if
+
+        // Collect all closed files of this and of previous runs. Their names sort chronologically.
+        boost::filesystem::path l_Path(m_FileName);
+        boost::filesystem::path l_Directory(l_Path.has_parent_path() ? l_Path.parent_path() : boost::filesystem::path("."));
+        static const boost::regex s_Special("[.^$|()\\[\\]{}*+?\\\\]");
+        boost::regex l_RegEx("^" + boost::regex_replace(l_Path.filename().string(), s_Special, "\\\\$&") + "\\.\\d{8}-\\d{6}\\.\\d{4}(\\.gz)?$");
+        std::vector<boost::filesystem::path> l_Files;
+        boost::system::error_code l_ErrorCode;
+        for (boost::filesystem::directory_iterator it(l_Directory, l_ErrorCode), l_End; it != l_End; it.increment(l_ErrorCode)) {
+            if (l_ErrorCode) {
+                break;
+            } // if
+
+            const boost::filesystem::path& l_File = it->path();
+            if ((boost::regex_match(l_File.filename().string(), l_RegEx)) &&
+                (l_File.filename() != boost::filesystem::path(l_CurrentFileName).filename()) &&
+                (l_File.filename() != boost::filesystem::path(l_PreOpenedFileName).filename())) {
+                l_Files.push_back(l_File);
+            } // if
+        } // for
+
+        std::sort(l_Files.begin(), l_Files.end());
+        std::time_t l_Now = std::time(NULL);
+        for (size_t l_Index = 0; l_Index < l_Files.size(); ++l_Index) {
+            bool l_bRemove = ((l_MaxFiles) && ((l_Files.size() - l_Index) > l_MaxFiles));
+            if ((!l_bRemove) && (l_MaxAge.count())) {
+                std::time_t l_LastWrite = boost::filesystem::last_write_time(l_Files[l_Index], l_ErrorCode);
+                l_bRemove = ((!l_ErrorCode) && ((l_Now - l_LastWrite) > l_MaxAge.count()));
+            } // if
+
+            if (l_bRemove) {
+                boost::filesystem::remove(l_Files[l_Index], l_ErrorCode);
+            } // if
+        } // for
+    }
+
+    // Constants
+    enum {
+        E_PUT_AREA_SIZE = 4096,
+        E_BLOCK_SIZE = (1024 * 1024),
+        E_MAX_BACKLOG_SIZE = (64 * E_BLOCK_SIZE)
+    };
+
+    // Members
+    std::ostream m_OutputStream;
+    std::string m_FileName;
+    bool m_bCompress;
+    uint64_t m_RotateSize;
+    std::chrono::seconds m_RotateInterval;
+    std::chrono::milliseconds m_FlushInterval;
+    std::string m_RunTimestamp;
+
+    std::vector<char> m_PutArea;
+    std::vector<char> m_FrontBuffer;
+    size_t m_FrontComplete;
+    bool m_bDropping;
+    uint64_t m_NbrOfDroppedBytes;
+    std::vector<char> m_BackBuffer;
+    std::vector<char> m_CompressBuffer;
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    bool m_bStopped;
+    bool m_bWriteError;
+    std::thread m_WriterThread;
+
+    // Only accessed by the writer thread after construction
+    std::FILE* m_File;
+    uint64_t m_FileBytes;
+    std::chrono::steady_clock::time_point m_FileOpened;
+    unsigned int m_FileCounter;
+#ifdef HDLCD_TOOLS_HAVE_ZLIB
+    z_stream m_ZStream;
+#endif
+
+    // Shared with the housekeeping thread
+    std::mutex m_HousekeepingMutex;
+    std::condition_variable m_HousekeepingCondition;
+    std::deque<std::FILE*> m_FilesToClose;
+    bool m_bPreOpenRequested;
+    unsigned int m_PreOpenCounter;
+    std::FILE* m_PreOpenedFile;
+    std::string m_PreOpenedFileName;
+    std::string m_CurrentFileName;
+    unsigned int m_MaxFiles;
+    std::chrono::seconds m_MaxAge;
+    bool m_bHousekeepingStopped;
+    std::thread m_HousekeepingThread;
+};
+
+#endif // OUTPUT_SINK_H
@@ -0,0 +1,87 @@
+/**
+ * \file PayloadDecoderRegistry.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAYLOAD_DECODER_REGISTRY_H
+#define PAYLOAD_DECODER_REGISTRY_H
+
+#include <iostream>
+#include <vector>
+
+// A payload decoder is a type with two static methods:
+//   static bool AcceptsLeadingByte(unsigned char a_Byte);
+//   static bool Decode(std::ostream& a_OutputStream, const unsigned char* a_Data, size_t a_Length);
+// Decode() writes one line and returns true, or returns false if the payload is not understood.
+typedef bool (*PayloadDecodeFunction)(std::ostream&, const unsigned char*, size_t);
+
+template<typename... Decoders>
+struct PayloadDecoderList;
+
+template<>
+struct PayloadDecoderList<> {
+    static void Register(PayloadDecodeFunction*) {
+    }
+};
+
+template<typename Decoder, typename... Decoders>
+struct PayloadDecoderList<Decoder, Decoders...> {
+    static void Register(PayloadDecodeFunction* a_DispatchTable) {
+        // The first decoder in the list that accepts a leading byte wins
+        for (unsigned int l_Byte = 0; l_Byte < 256; ++l_Byte) {
+            if ((!a_DispatchTable[l_Byte]) && (Decoder::AcceptsLeadingByte((unsigned char)l_Byte))) {
+                a_DispatchTable[l_Byte] = &Decoder::Decode;
+            } // if
+        } // for
+
+        PayloadDecoderList<Decoders...>::Register(a_DispatchTable);
+    }
+};
+
+template<typename... Decoders>
+class PayloadDecoderRegistry {
+public:
+    // CTOR: the dispatch table is built once, decoding a payload is a table lookup and a direct call
+    PayloadDecoderRegistry() {
+        for (unsigned int l_Byte = 0; l_Byte < 256; ++l_Byte) {
+            m_DispatchTable[l_Byte] = NULL;
+        } // for
+
+        PayloadDecoderList<Decoders...>::Register(m_DispatchTable);
+    }
+
+    bool Decode(std::ostream& a_OutputStream, const std::vector<unsigned char>& a_Payload) const {
+        if (a_Payload.empty()) {
+            return false;
+        } // if
+
+        PayloadDecodeFunction l_DecodeFunction = m_DispatchTable[a_Payload[0]];
+        if (!l_DecodeFunction) {
+            return false;
+        } // if
+
+        return l_DecodeFunction(a_OutputStream, a_Payload.data(), a_Payload.size());
+    }
+
+private:
+    // Members
+    PayloadDecodeFunction m_DispatchTable[256];
+};
+
+#endif // PAYLOAD_DECODER_REGISTRY_H
@@ -0,0 +1,103 @@
+/**
+ * \file PayloadDecoders.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAYLOAD_DECODERS_H
+#define PAYLOAD_DECODERS_H
+
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include "PayloadDecoderRegistry.h"
+
+// Messages of the application protocol, identified by their first four bytes
+typedef struct {
+    unsigned char m_Prefix[4];
+    const char* m_Name;
+} KnownMessage;
+
+static const KnownMessage s_KnownMessages[] = {
+    { { 0x00, 0x00, 0x40, 0x01 }, "Request firmware" }
+};
+
+class KnownMessageDecoder {
+public:
+    static bool AcceptsLeadingByte(unsigned char a_Byte) {
+        for (size_t l_Index = 0; l_Index < (sizeof(s_KnownMessages) / sizeof(s_KnownMessages[0])); ++l_Index) {
+            if (s_KnownMessages[l_Index].m_Prefix[0] == a_Byte) {
+                return true;
+            } // if
+        } // for
+
+        return false;
+    }
+
+    static bool Decode(std::ostream& a_OutputStream, const unsigned char* a_Data, size_t a_Length) {
+        if (a_Length < 4) {
+            return false;
+        } // if
+
+        for (size_t l_Index = 0; l_Index < (sizeof(s_KnownMessages) / sizeof(s_KnownMessages[0])); ++l_Index) {
+            if (::memcmp(s_KnownMessages[l_Index].m_Prefix, a_Data, 4) == 0) {
+                a_OutputStream << "    " << s_KnownMessages[l_Index].m_Name << ":";
+                for (size_t l_Offset = 4; l_Offset < a_Length; ++l_Offset) {
+                    a_OutputStream << " " << std::hex << std::setw(2) << std::setfill('0') << int(a_Data[l_Offset]);
+                } // for
+
+                a_OutputStream << std::endl;
+                return true;
+            } // if
+        } // for
+
+        return false;
+    }
+};
+
+// Payloads that consist of printable characters only, e.g., debug output of a device
+class TextDecoder {
+public:
+    static bool AcceptsLeadingByte(unsigned char a_Byte) {
+        return ((a_Byte >= 0x20) && (a_Byte < 0x7F));
+    }
+
+    static bool Decode(std::ostream& a_OutputStream, const unsigned char* a_Data, size_t a_Length) {
+        for (size_t l_Index = 0; l_Index < a_Length; ++l_Index) {
+            unsigned char l_Byte = a_Data[l_Index];
+            if (((l_Byte < 0x20) || (l_Byte >= 0x7F)) && (l_Byte != '\r') && (l_Byte != '\n') && (l_Byte != '\t')) {
+                return false;
+            } // if
+        } // for
+
+        a_OutputStream << "    Text: \"";
+        for (size_t l_Index = 0; l_Index < a_Length; ++l_Index) {
+            if ((a_Data[l_Index] != '\r') && (a_Data[l_Index] != '\n')) {
+                a_OutputStream << char(a_Data[l_Index]);
+            } // if
+        } // for
+
+        a_OutputStream << "\"" << std::endl;
+        return true;
+    }
+};
+
+// All decoders known to the tools. Add new decoders here, earlier entries take precedence.
+typedef PayloadDecoderRegistry<KnownMessageDecoder, TextDecoder> DefaultPayloadDecoderRegistry;
+
+#endif // PAYLOAD_DECODERS_H
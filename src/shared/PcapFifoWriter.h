@@ -0,0 +1,242 @@
+/**
+ * \file PcapFifoWriter.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PCAP_FIFO_WRITER_H
+#define PCAP_FIFO_WRITER_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include "PcapWriter.h"
+
+// Streams pcap records to a named FIFO, e.g., to be read by "wireshark -k -i <FIFO>". Nothing blocks the io_service:
+// frames are dropped while no reader is attached, each new reader gets its own pcap file header.
+class PcapFifoWriter {
+public:
+    // CTOR: writes are coalesced for at most the flush delay, the backlog limits the memory used if the reader is slow
+    PcapFifoWriter(boost::asio::io_service& a_IoService, const std::string& a_FileName, uint32_t a_LinkType,
+                   std::chrono::milliseconds a_FlushDelay, size_t a_MaxBacklog):
+        m_FileName(a_FileName), m_FlushDelay(a_FlushDelay), m_MaxBacklog(a_MaxBacklog), m_bCreated(false), m_Fifo(a_IoService),
+        m_FlushTimer(a_IoService), m_RetryTimer(a_IoService), m_bClosed(false), m_bConnected(false), m_bWriting(false), m_bFlushScheduled(false),
+        m_PendingFrames(0), m_WritingFrames(0), m_NbrOfWritten(0), m_NbrOfDropped(0), m_NbrOfLost(0), m_NbrOfReaders(0) {
+        std::ostringstream l_FileHeader;
+        WritePcapFileHeader(l_FileHeader, a_LinkType);
+        m_FileHeader = l_FileHeader.str();
+
+        struct stat l_Stat;
+        if (::stat(m_FileName.c_str(), &l_Stat) == 0) {
+            if (!S_ISFIFO(l_Stat.st_mode)) {
+                throw std::runtime_error(m_FileName + " exists but is not a named FIFO");
+            } // if
+        } else if (::mkfifo(m_FileName.c_str(), 0600) == 0) {
+            m_bCreated = true;
+        } else {
+            throw std::runtime_error("failed to create named FIFO " + m_FileName + ": " + ::strerror(errno));
+        } // else
+
+        std::cerr << "Waiting for a reader on " << m_FileName << ", e.g., wireshark -k -i " << m_FileName << std::endl;
+        TryOpen();
+    }
+
+    // DTOR
+    ~PcapFifoWriter() {
+        Close();
+        if (m_bCreated) {
+            ::unlink(m_FileName.c_str());
+        } // if
+    }
+
+    // Cancels both timers and stops waiting for readers, e.g., if the connection failed. Otherwise they keep the io_service running.
+    void Close() {
+        m_bClosed = true;
+        m_FlushTimer.cancel();
+        m_RetryTimer.cancel();
+        boost::system::error_code l_ErrorCode;
+        m_Fifo.close(l_ErrorCode);
+        m_bConnected = false;
+    }
+
+    void Write(int64_t a_Timestamp, const std::vector<unsigned char>& a_Data) {
+        size_t l_CapturedLength = GetPcapCapturedLength(a_Data.size());
+        if ((!m_bConnected) || ((m_PendingBuffer.size() + E_RECORD_HEADER_SIZE + l_CapturedLength) > m_MaxBacklog)) {
+            ++m_NbrOfDropped;
+            return;
+        } // if
+
+        size_t l_Offset = m_PendingBuffer.size();
+        m_PendingBuffer.resize(l_Offset + E_RECORD_HEADER_SIZE + l_CapturedLength);
+        size_t l_HeaderSize = EncodePcapRecordHeader(&m_PendingBuffer[l_Offset], a_Timestamp, a_Data.size());
+        if (l_CapturedLength) {
+            ::memcpy(&m_PendingBuffer[l_Offset + l_HeaderSize], a_Data.data(), l_CapturedLength);
+        } // if
+
+        ++m_PendingFrames;
+        if (m_PendingBuffer.size() >= E_FLUSH_THRESHOLD) {
+            // Under load: do not wait for the deadline
+            Flush();
+        } else {
+            ScheduleFlush();
+        } // else
+    }
+
+    void PrintStatistics(std::ostream& a_OutputStream) const {
+        a_OutputStream << std::dec << "Pcap FIFO: " << m_NbrOfWritten << " frames written to " << m_NbrOfReaders << " readers, "
+                       << m_NbrOfDropped << " frames dropped without reader or due to backlog, "
+                       << m_NbrOfLost << " frames lost on disconnect" << std::endl;
+    }
+
+private:
+    // Helpers
+    void TryOpen() {
+        if (m_bClosed) {
+            return;
+        } // if
+
+        // Opening for writing without blocking fails with ENXIO while no reader is attached
+        int l_FileDescriptor = ::open(m_FileName.c_str(), O_WRONLY | O_NONBLOCK);
+        if (l_FileDescriptor < 0) {
+            if (errno != ENXIO) {
+                std::cerr << "Failed to open " << m_FileName << ": " << ::strerror(errno) << std::endl;
+            } // if
+
+            m_RetryTimer.expires_from_now(std::chrono::milliseconds(E_RETRY_INTERVAL_MS));
+            m_RetryTimer.async_wait([this](const boost::system::error_code& a_ErrorCode) {
+                if (!a_ErrorCode) {
+                    TryOpen();
+                } // if
+            });
+
+            return;
+        } // if
+
+        m_Fifo.assign(l_FileDescriptor);
+        m_Fifo.non_blocking(true);
+        m_bConnected = true;
+        ++m_NbrOfReaders;
+        std::cerr << "Reader attached to " << m_FileName << std::endl;
+        m_PendingBuffer.assign(m_FileHeader.begin(), m_FileHeader.end());
+        m_PendingFrames = 0;
+        Flush();
+    }
+
+    void ScheduleFlush() {
+        if (m_bFlushScheduled) {
+            return;
+        } // if
+
+        m_bFlushScheduled = true;
+        m_FlushTimer.expires_from_now(m_FlushDelay);
+        m_FlushTimer.async_wait([this](const boost::system::error_code& a_ErrorCode) {
+            m_bFlushScheduled = false;
+            if (!a_ErrorCode) {
+                Flush();
+            } // if
+        });
+    }
+
+    void Flush() {
+        if ((m_bWriting) || (m_PendingBuffer.empty()) || (!m_bConnected)) {
+            // Pending data is written on completion of the current write
+            return;
+        } // if
+
+        m_WritingBuffer.swap(m_PendingBuffer);
+        m_WritingFrames = m_PendingFrames;
+        m_PendingFrames = 0;
+        m_bWriting = true;
+        boost::asio::async_write(m_Fifo, boost::asio::buffer(m_WritingBuffer), [this](const boost::system::error_code& a_ErrorCode, std::size_t) {
+            m_bWriting = false;
+            if (a_ErrorCode == boost::asio::error::operation_aborted) {
+                return;
+            } // if
+
+            if (a_ErrorCode) {
+                // EPIPE: the reader went away. Records may be truncated, the next reader gets a new file.
+                std::cerr << "Reader detached from " << m_FileName << ": " << a_ErrorCode.message() << std::endl;
+                m_NbrOfLost += (m_WritingFrames + m_PendingFrames);
+                m_WritingBuffer.clear();
+                m_PendingBuffer.clear();
+                m_WritingFrames = 0;
+                m_PendingFrames = 0;
+                boost::system::error_code l_ErrorCode;
+                m_Fifo.close(l_ErrorCode);
+                m_bConnected = false;
+                TryOpen();
+                return;
+            } // if
+
+            m_NbrOfWritten += m_WritingFrames;
+            m_WritingFrames = 0;
+            m_WritingBuffer.clear();
+            if (m_PendingBuffer.size() >= E_FLUSH_THRESHOLD) {
+                Flush();
+            } else if (!m_PendingBuffer.empty()) {
+                ScheduleFlush();
+            } // else if
+        });
+    }
+
+    // Constants
+    enum {
+        E_RECORD_HEADER_SIZE = 16,
+        E_FLUSH_THRESHOLD = 65536,
+        E_RETRY_INTERVAL_MS = 250
+    };
+
+    // Members
+    std::string m_FileName;
+    std::string m_FileHeader;
+    std::chrono::milliseconds m_FlushDelay;
+    size_t m_MaxBacklog;
+    bool m_bCreated;
+    boost::asio::posix::stream_descriptor m_Fifo;
+    boost::asio::steady_timer m_FlushTimer;
+    boost::asio::steady_timer m_RetryTimer;
+    bool m_bClosed;
+    bool m_bConnected;
+    bool m_bWriting;
+    bool m_bFlushScheduled;
+
+    // Double buffering: records are appended to the pending buffer while the writing buffer is in flight
+    std::vector<char> m_PendingBuffer;
+    std::vector<char> m_WritingBuffer;
+    size_t m_PendingFrames;
+    size_t m_WritingFrames;
+
+    // Statistics
+    size_t m_NbrOfWritten;
+    size_t m_NbrOfDropped;
+    size_t m_NbrOfLost;
+    size_t m_NbrOfReaders;
+};
+
+#endif // PCAP_FIFO_WRITER_H
@@ -0,0 +1,80 @@
+/**
+ * \file PcapWriter.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PCAP_WRITER_H
+#define PCAP_WRITER_H
+
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// Link types: configure Wireshark via "DLT_USER" to dissect them
+enum {
+    PCAP_LINKTYPE_HDLC    = 147, // LINKTYPE_USER0: complete HDLC frames as delivered by the HDLCd
+    PCAP_LINKTYPE_PAYLOAD = 148  // LINKTYPE_USER1: payload of HDLC frames
+};
+
+// Longer frames are truncated, their original length is kept in the record header
+enum {
+    PCAP_SNAPLEN = 65535
+};
+
+size_t GetPcapCapturedLength(size_t a_Length) {
+    return std::min(a_Length, size_t(PCAP_SNAPLEN));
+}
+
+void WritePcapFileHeader(std::ostream& a_OutputStream, uint32_t a_LinkType) {
+    // Host byte order, the reader detects it via the magic number
+    uint32_t l_Magic = 0xa1b2c3d4;
+    uint16_t l_VersionMajor = 2;
+    uint16_t l_VersionMinor = 4;
+    int32_t  l_ThisZone = 0;
+    uint32_t l_SigFigs = 0;
+    uint32_t l_SnapLen = PCAP_SNAPLEN;
+    a_OutputStream.write((const char*)&l_Magic, sizeof(l_Magic));
+    a_OutputStream.write((const char*)&l_VersionMajor, sizeof(l_VersionMajor));
+    a_OutputStream.write((const char*)&l_VersionMinor, sizeof(l_VersionMinor));
+    a_OutputStream.write((const char*)&l_ThisZone, sizeof(l_ThisZone));
+    a_OutputStream.write((const char*)&l_SigFigs, sizeof(l_SigFigs));
+    a_OutputStream.write((const char*)&l_SnapLen, sizeof(l_SnapLen));
+    a_OutputStream.write((const char*)&a_LinkType, sizeof(a_LinkType));
+}
+
+size_t EncodePcapRecordHeader(char* a_Header, int64_t a_Timestamp, size_t a_Length) {
+    // The timestamp is given in microseconds since the epoch. Returns the size of the header.
+    // The caller must append GetPcapCapturedLength(a_Length) bytes only.
+    uint32_t l_Header[4];
+    l_Header[0] = (a_Timestamp / 1000000);
+    l_Header[1] = (a_Timestamp % 1000000);
+    l_Header[2] = GetPcapCapturedLength(a_Length);
+    l_Header[3] = a_Length;
+    ::memcpy(a_Header, l_Header, sizeof(l_Header));
+    return sizeof(l_Header);
+}
+
+void WritePcapRecord(std::ostream& a_OutputStream, int64_t a_Timestamp, const unsigned char* a_Data, size_t a_Length) {
+    char l_Header[16];
+    a_OutputStream.write(l_Header, EncodePcapRecordHeader(l_Header, a_Timestamp, a_Length));
+    a_OutputStream.write((const char*)a_Data, GetPcapCapturedLength(a_Length));
+}
+
+#endif // PCAP_WRITER_H
@@ -0,0 +1,138 @@
+/**
+ * \file SendWindow.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEND_WINDOW_H
+#define SEND_WINDOW_H
+
+#include <iostream>
+#include <chrono>
+#include <functional>
+#include "HdlcdClient.h"
+
+class SendWindow {
+public:
+    // CTOR: the producer is paused if one of the high water marks is reached, and resumed if both are below the low water marks
+    SendWindow(HdlcdClient& a_HdlcdClient, size_t a_HighWaterBytes, size_t a_HighWaterFrames):
+        m_HdlcdClient(a_HdlcdClient), m_HighWaterBytes(a_HighWaterBytes), m_HighWaterFrames(a_HighWaterFrames),
+        m_LowWaterBytes(a_HighWaterBytes / 2), m_LowWaterFrames(a_HighWaterFrames / 2), m_OutstandingBytes(0), m_OutstandingFrames(0),
+        m_bPaused(false), m_SentFrames(0), m_MaxOutstandingBytes(0), m_MaxOutstandingFrames(0), m_NbrOfPauses(0),
+        m_PausedTime(std::chrono::steady_clock::duration::zero()) {
+    }
+
+    void SetOnPauseCallback(std::function<void()> a_OnPauseCallback) {
+        m_OnPauseCallback = a_OnPauseCallback;
+    }
+
+    void SetOnResumeCallback(std::function<void()> a_OnResumeCallback) {
+        m_OnResumeCallback = a_OnResumeCallback;
+    }
+
+    // The optional callback is invoked when the packet left the send queue of the HDLCd client
+    void Send(const HdlcdPacketData& a_PacketData, std::function<void()> a_OnSentCallback = std::function<void()>()) {
+        size_t l_Size = a_PacketData.GetData().size();
+        m_OutstandingBytes += l_Size;
+        ++m_OutstandingFrames;
+        ++m_SentFrames;
+        if (m_OutstandingBytes > m_MaxOutstandingBytes) {
+            m_MaxOutstandingBytes = m_OutstandingBytes;
+        } // if
+
+        if (m_OutstandingFrames > m_MaxOutstandingFrames) {
+            m_MaxOutstandingFrames = m_OutstandingFrames;
+        } // if
+
+        bool l_bQueued = m_HdlcdClient.Send(a_PacketData, [this, l_Size, a_OnSentCallback]() {
+            // The packet left the send queue of the HDLCd client
+            m_OutstandingBytes -= l_Size;
+            --m_OutstandingFrames;
+            if (a_OnSentCallback) {
+                a_OnSentCallback();
+            } // if
+
+            if ((m_bPaused) && (m_OutstandingBytes <= m_LowWaterBytes) && (m_OutstandingFrames <= m_LowWaterFrames)) {
+                m_bPaused = false;
+                m_PausedTime += (std::chrono::steady_clock::now() - m_PausedSince);
+                if (m_OnResumeCallback) {
+                    m_OnResumeCallback();
+                } // if
+            } // if
+        });
+
+        if (!l_bQueued) {
+            // The client is already closed, the callback will never be invoked
+            m_OutstandingBytes -= l_Size;
+            --m_OutstandingFrames;
+            return;
+        } // if
+
+        if ((!m_bPaused) && ((m_OutstandingBytes >= m_HighWaterBytes) || (m_OutstandingFrames >= m_HighWaterFrames))) {
+            m_bPaused = true;
+            m_PausedSince = std::chrono::steady_clock::now();
+            ++m_NbrOfPauses;
+            if (m_OnPauseCallback) {
+                m_OnPauseCallback();
+            } // if
+        } // if
+    }
+
+    size_t GetOutstandingBytes() const {
+        return m_OutstandingBytes;
+    }
+
+    size_t GetOutstandingFrames() const {
+        return m_OutstandingFrames;
+    }
+
+    void PrintStatistics(std::ostream& a_OutputStream) const {
+        auto l_PausedTime = m_PausedTime;
+        if (m_bPaused) {
+            l_PausedTime += (std::chrono::steady_clock::now() - m_PausedSince);
+        } // if
+
+        a_OutputStream << std::dec << "Send window: " << m_SentFrames << " frames sent, max. queue depth "
+                       << m_MaxOutstandingFrames << " frames / " << m_MaxOutstandingBytes << " bytes, input paused "
+                       << m_NbrOfPauses << " times for " << std::chrono::duration_cast<std::chrono::milliseconds>(l_PausedTime).count()
+                       << " ms, still queued " << m_OutstandingFrames << " frames" << std::endl;
+    }
+
+private:
+    // Members
+    HdlcdClient& m_HdlcdClient;
+    size_t m_HighWaterBytes;
+    size_t m_HighWaterFrames;
+    size_t m_LowWaterBytes;
+    size_t m_LowWaterFrames;
+    size_t m_OutstandingBytes;
+    size_t m_OutstandingFrames;
+    bool m_bPaused;
+    std::chrono::steady_clock::time_point m_PausedSince;
+    std::function<void()> m_OnPauseCallback;
+    std::function<void()> m_OnResumeCallback;
+
+    // Statistics
+    size_t m_SentFrames;
+    size_t m_MaxOutstandingBytes;
+    size_t m_MaxOutstandingFrames;
+    size_t m_NbrOfPauses;
+    std::chrono::steady_clock::duration m_PausedTime;
+};
+
+#endif // SEND_WINDOW_H
@@ -0,0 +1,237 @@
+/**
+ * \file StageProfiler.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STAGE_PROFILER_H
+#define STAGE_PROFILER_H
+
+#include "Config.h"
+
+// Stages of the hot path of the dump tools
+typedef enum {
+    PROFILER_STAGE_RECEIVE = 0, // Data callback of the HDLCd client, entry to exit
+    PROFILER_STAGE_FORMAT,      // Formatting of a single frame into a stream
+    PROFILER_STAGE_WRITE,       // Writing formatted output to STDOUT or to a file
+    PROFILER_STAGE_COUNT
+} E_PROFILER_STAGE;
+
+#ifdef HDLCD_TOOLS_PROFILING
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <boost/asio.hpp>
+
+class StageProfiler {
+    // Constants: one bucket per power of two of nanoseconds
+    enum {
+        E_NBR_OF_BUCKETS = 40
+    };
+
+public:
+    // Types
+    struct StageHistogram {
+        StageHistogram(): m_Count(0), m_SumNs(0), m_MaxNs(0) {
+            for (size_t l_Index = 0; l_Index < E_NBR_OF_BUCKETS; ++l_Index) {
+                m_Buckets[l_Index] = 0;
+            } // for
+        }
+
+        // Only written by the owning thread: relaxed loads and stores, no read-modify-write
+        void Record(uint64_t a_Nanoseconds) {
+            m_Count.store(m_Count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            m_SumNs.store(m_SumNs.load(std::memory_order_relaxed) + a_Nanoseconds, std::memory_order_relaxed);
+            if (a_Nanoseconds > m_MaxNs.load(std::memory_order_relaxed)) {
+                m_MaxNs.store(a_Nanoseconds, std::memory_order_relaxed);
+            } // if
+
+            std::atomic<uint64_t>& l_Bucket = m_Buckets[GetBucket(a_Nanoseconds)];
+            l_Bucket.store(l_Bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        std::atomic<uint64_t> m_Count;
+        std::atomic<uint64_t> m_SumNs;
+        std::atomic<uint64_t> m_MaxNs;
+        std::atomic<uint64_t> m_Buckets[E_NBR_OF_BUCKETS];
+    };
+
+    struct ThreadProfile {
+        std::string m_Name;
+        StageHistogram m_Stages[PROFILER_STAGE_COUNT];
+    };
+
+    static StageProfiler& Instance() {
+        static StageProfiler s_StageProfiler;
+        return s_StageProfiler;
+    }
+
+    // The profile of the calling thread, created on first use. It is kept until exit to be dumped after the thread terminated.
+    ThreadProfile& GetThreadProfile() {
+        static thread_local ThreadProfile* s_ThreadProfile = NULL;
+        if (!s_ThreadProfile) {
+            std::lock_guard<std::mutex> l_Lock(m_Mutex);
+            m_ThreadProfiles.emplace_back(new ThreadProfile);
+            s_ThreadProfile = m_ThreadProfiles.back().get();
+            s_ThreadProfile->m_Name = ("thread " + std::to_string(m_ThreadProfiles.size()));
+        } // if
+
+        return *s_ThreadProfile;
+    }
+
+    void SetThreadName(const std::string& a_Name) {
+        ThreadProfile& l_ThreadProfile = GetThreadProfile();
+        std::lock_guard<std::mutex> l_Lock(m_Mutex);
+        l_ThreadProfile.m_Name = a_Name;
+    }
+
+    void Dump(std::ostream& a_OutputStream) {
+        static const char* s_StageNames[PROFILER_STAGE_COUNT] = { "receive", "format", "write" };
+        std::lock_guard<std::mutex> l_Lock(m_Mutex);
+        a_OutputStream << std::dec << std::fixed << std::setprecision(2)
+                       << "Thread       Stage          count     avg us     p50 us     p99 us     max us" << std::endl;
+        for (auto it = m_ThreadProfiles.begin(); it != m_ThreadProfiles.end(); ++it) {
+            for (size_t l_Stage = 0; l_Stage < PROFILER_STAGE_COUNT; ++l_Stage) {
+                const StageHistogram& l_StageHistogram = (*it)->m_Stages[l_Stage];
+                uint64_t l_Count = l_StageHistogram.m_Count.load(std::memory_order_relaxed);
+                if (!l_Count) {
+                    continue;
+                } // if
+
+                a_OutputStream << std::left << std::setw(13) << (*it)->m_Name << std::setw(8) << s_StageNames[l_Stage] << std::right
+                               << std::setw(12) << l_Count
+                               << std::setw(11) << (l_StageHistogram.m_SumNs.load(std::memory_order_relaxed) / 1000.0 / l_Count)
+                               << std::setw(11) << (GetPercentile(l_StageHistogram, l_Count, 50) / 1000.0)
+                               << std::setw(11) << (GetPercentile(l_StageHistogram, l_Count, 99) / 1000.0)
+                               << std::setw(11) << (l_StageHistogram.m_MaxNs.load(std::memory_order_relaxed) / 1000.0) << std::endl;
+            } // for
+        } // for
+    }
+
+private:
+    // CTOR
+    StageProfiler() {
+    }
+
+    // Helpers
+    static size_t GetBucket(uint64_t a_Nanoseconds) {
+#if defined(__GNUC__)
+        size_t l_Bucket = (63 - __builtin_clzll(a_Nanoseconds | 1));
+#else
+        size_t l_Bucket = 0;
+        while (a_Nanoseconds >>= 1) {
+            ++l_Bucket;
+        } // while
+#endif
+        return ((l_Bucket < E_NBR_OF_BUCKETS) ? l_Bucket : (E_NBR_OF_BUCKETS - 1));
+    }
+
+    static uint64_t GetPercentile(const StageHistogram& a_StageHistogram, uint64_t a_Count, unsigned int a_Percent) {
+        // The upper bound of the bucket containing the percentile
+        uint64_t l_Accumulated = 0;
+        for (size_t l_Index = 0; l_Index < E_NBR_OF_BUCKETS; ++l_Index) {
+            l_Accumulated += a_StageHistogram.m_Buckets[l_Index].load(std::memory_order_relaxed);
+            if ((l_Accumulated * 100) >= (a_Count * a_Percent)) {
+                return (uint64_t(2) << l_Index);
+            } // if
+        } // for
+
+        return a_StageHistogram.m_MaxNs.load(std::memory_order_relaxed);
+    }
+
+    // Members
+    std::mutex m_Mutex;
+    std::vector<std::unique_ptr<ThreadProfile>> m_ThreadProfiles;
+};
+
+// Measures the lifetime of a scope
+class StageProfilerScope {
+public:
+    // CTOR
+    StageProfilerScope(E_PROFILER_STAGE a_eStage): m_eStage(a_eStage), m_Start(std::chrono::steady_clock::now()) {
+    }
+
+    // DTOR
+    ~StageProfilerScope() {
+        uint64_t l_Nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_Start).count();
+        StageProfiler::Instance().GetThreadProfile().m_Stages[m_eStage].Record(l_Nanoseconds);
+    }
+
+private:
+    // Members
+    E_PROFILER_STAGE m_eStage;
+    std::chrono::steady_clock::time_point m_Start;
+};
+
+// Dumps all profiles to STDERR on SIGUSR2 and on destruction
+class StageProfilerDumper {
+public:
+    // CTOR
+    StageProfilerDumper(boost::asio::io_service& a_IoService): m_Signals(a_IoService) {
+        // Created by the thread that runs the io_service
+        StageProfiler::Instance().SetThreadName("network");
+#if defined(SIGUSR2)
+        m_Signals.add(SIGUSR2);
+        AsyncWaitForSignal();
+#endif
+    }
+
+    // DTOR
+    ~StageProfilerDumper() {
+        StageProfiler::Instance().Dump(std::cerr);
+    }
+
+    // Stop waiting for SIGUSR2, e.g., if the connection failed. Otherwise the signal set keeps the io_service running.
+    void Cancel() {
+        m_Signals.cancel();
+    }
+
+private:
+    // Helpers
+    void AsyncWaitForSignal() {
+        m_Signals.async_wait([this](const boost::system::error_code& a_ErrorCode, int) {
+            if (!a_ErrorCode) {
+                StageProfiler::Instance().Dump(std::cerr);
+                AsyncWaitForSignal();
+            } // if
+        });
+    }
+
+    // Members
+    boost::asio::signal_set m_Signals;
+};
+
+#define STAGE_PROFILER_SCOPE(a_eStage) StageProfilerScope l_StageProfilerScope(a_eStage)
+#define STAGE_PROFILER_THREAD(a_Name) StageProfiler::Instance().SetThreadName(a_Name)
+#define STAGE_PROFILER_DUMPER(a_IoService) StageProfilerDumper l_StageProfilerDumper(a_IoService)
+#define STAGE_PROFILER_CANCEL() l_StageProfilerDumper.Cancel()
+#else
+// Compiled out: no code, no data
+#define STAGE_PROFILER_SCOPE(a_eStage)
+#define STAGE_PROFILER_THREAD(a_Name)
+#define STAGE_PROFILER_DUMPER(a_IoService)
+#define STAGE_PROFILER_CANCEL()
+#endif // HDLCD_TOOLS_PROFILING
+
+#endif // STAGE_PROFILER_H
@@ -0,0 +1,246 @@
+/**
+ * \file StructuredPrinter.h
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STRUCTURED_PRINTER_H
+#define STRUCTURED_PRINTER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "FrameTimestamp.h"
+
+typedef enum {
+    OUTPUT_FORMAT_TEXT = 0, // Human readable, tool specific
+    OUTPUT_FORMAT_JSON = 1, // One JSON object per line
+    OUTPUT_FORMAT_CBOR = 2  // A sequence of CBOR maps (RFC 7049), one per frame
+} E_OUTPUT_FORMAT;
+
+bool ParseOutputFormat(const std::string& a_Name, E_OUTPUT_FORMAT& a_OutputFormat) {
+    if (a_Name == "text") {
+        a_OutputFormat = OUTPUT_FORMAT_TEXT;
+    } else if (a_Name == "json") {
+        a_OutputFormat = OUTPUT_FORMAT_JSON;
+    } else if (a_Name == "cbor") {
+        a_OutputFormat = OUTPUT_FORMAT_CBOR;
+    } else {
+        return false;
+    } // else
+
+    return true;
+}
+
+class StructuredPrinter {
+public:
+    // CTOR: text payloads, e.g., of the dissector, are emitted as strings instead of binary data
+    StructuredPrinter(E_OUTPUT_FORMAT a_OutputFormat, const std::string& a_Device, bool a_bTextPayload = false):
+        m_OutputFormat(a_OutputFormat), m_bTextPayload(a_bTextPayload) {
+        // The device name is the same for all frames: encode it only once
+        if (m_OutputFormat == OUTPUT_FORMAT_JSON) {
+            m_Device = "{\"device\":\"";
+            for (auto it = a_Device.begin(); it != a_Device.end(); ++it) {
+                AppendJsonChar(m_Device, (unsigned char)*it);
+            } // for
+
+            m_Device.append("\",");
+        } else if (m_OutputFormat == OUTPUT_FORMAT_CBOR) {
+            char l_Head[9];
+            m_Device.push_back(char(0xA6)); // Map with 6 pairs
+            m_Device.append(l_Head, CborHead(l_Head, 3, 6));
+            m_Device.append("device");
+            m_Device.append(l_Head, CborHead(l_Head, 3, a_Device.size()));
+            m_Device.append(a_Device);
+        } // else if
+    }
+
+    // Fields: device, dir ("sent" or "rcvd"), ts (microseconds since the epoch, UTC), invalid (CRC broken), len, and either data (bytes) or text
+    void Print(std::ostream& a_OutputStream, bool a_bWasSent, bool a_bInvalid, const FrameTimestamp& a_FrameTimestamp, const std::vector<unsigned char>& a_Buffer) const {
+        if (m_OutputFormat == OUTPUT_FORMAT_JSON) {
+            PrintJson(a_OutputStream, a_bWasSent, a_bInvalid, a_FrameTimestamp, a_Buffer);
+        } else {
+            PrintCbor(a_OutputStream, a_bWasSent, a_bInvalid, a_FrameTimestamp, a_Buffer);
+        } // else
+    }
+
+private:
+    // Helpers
+    void PrintJson(std::ostream& a_OutputStream, bool a_bWasSent, bool a_bInvalid, const FrameTimestamp& a_FrameTimestamp, const std::vector<unsigned char>& a_Buffer) const {
+        // All fields are rendered into a buffer on the stack, only the payload may need several chunks
+        char l_Chunk[256];
+        char* l_Pos = l_Chunk;
+        l_Pos = AppendLiteral(l_Pos, (a_bWasSent ? "\"dir\":\"sent\",\"ts\":" : "\"dir\":\"rcvd\",\"ts\":"));
+        l_Pos = AppendDecimal(l_Pos, a_FrameTimestamp.GetMicroseconds());
+        l_Pos = AppendLiteral(l_Pos, (a_bInvalid ? ",\"invalid\":true,\"len\":" : ",\"invalid\":false,\"len\":"));
+        l_Pos = AppendDecimal(l_Pos, a_Buffer.size());
+        l_Pos = AppendLiteral(l_Pos, (m_bTextPayload ? ",\"text\":\"" : ",\"data\":\""));
+        a_OutputStream.write(m_Device.data(), m_Device.size());
+        a_OutputStream.write(l_Chunk, l_Pos - l_Chunk);
+        l_Pos = l_Chunk;
+        if (m_bTextPayload) {
+            for (auto it = a_Buffer.begin(); it != a_Buffer.end(); ++it) {
+                if ((l_Chunk + sizeof(l_Chunk) - l_Pos) < 8) {
+                    a_OutputStream.write(l_Chunk, l_Pos - l_Chunk);
+                    l_Pos = l_Chunk;
+                } // if
+
+                l_Pos = AppendJsonChar(l_Pos, *it);
+            } // for
+        } else {
+            // Base64: 48 bytes of payload become 64 characters
+            for (size_t l_Offset = 0; l_Offset < a_Buffer.size(); l_Offset += 48) {
+                l_Pos = AppendBase64(l_Chunk, a_Buffer.data() + l_Offset, std::min<size_t>(48, a_Buffer.size() - l_Offset));
+                a_OutputStream.write(l_Chunk, l_Pos - l_Chunk);
+            } // for
+
+            l_Pos = l_Chunk;
+        } // else
+
+        l_Pos = AppendLiteral(l_Pos, "\"}");
+        a_OutputStream.write(l_Chunk, l_Pos - l_Chunk);
+        a_OutputStream << std::endl;
+    }
+
+    void PrintCbor(std::ostream& a_OutputStream, bool a_bWasSent, bool a_bInvalid, const FrameTimestamp& a_FrameTimestamp, const std::vector<unsigned char>& a_Buffer) const {
+        char l_Chunk[128];
+        char* l_Pos = l_Chunk;
+        l_Pos += CborHead(l_Pos, 3, 3);
+        l_Pos = AppendLiteral(l_Pos, "dir");
+        l_Pos += CborHead(l_Pos, 3, 4);
+        l_Pos = AppendLiteral(l_Pos, (a_bWasSent ? "sent" : "rcvd"));
+        l_Pos += CborHead(l_Pos, 3, 2);
+        l_Pos = AppendLiteral(l_Pos, "ts");
+        l_Pos += CborHead(l_Pos, 0, a_FrameTimestamp.GetMicroseconds());
+        l_Pos += CborHead(l_Pos, 3, 7);
+        l_Pos = AppendLiteral(l_Pos, "invalid");
+        *l_Pos++ = (a_bInvalid ? char(0xF5) : char(0xF4));
+        l_Pos += CborHead(l_Pos, 3, 3);
+        l_Pos = AppendLiteral(l_Pos, "len");
+        l_Pos += CborHead(l_Pos, 0, a_Buffer.size());
+        l_Pos += CborHead(l_Pos, 3, 4);
+        l_Pos = AppendLiteral(l_Pos, (m_bTextPayload ? "text" : "data"));
+        l_Pos += CborHead(l_Pos, (m_bTextPayload ? 3 : 2), a_Buffer.size());
+        a_OutputStream.write(m_Device.data(), m_Device.size());
+        a_OutputStream.write(l_Chunk, l_Pos - l_Chunk);
+        a_OutputStream.write((const char*)a_Buffer.data(), a_Buffer.size());
+
+        // Each record is a unit for the output sink, e.g., regarding file rotation
+        a_OutputStream.flush();
+    }
+
+    static size_t CborHead(char* a_Pos, unsigned char a_MajorType, uint64_t a_Value) {
+        unsigned char l_Major = (a_MajorType << 5);
+        if (a_Value < 24) {
+            a_Pos[0] = char(l_Major | a_Value);
+            return 1;
+        } // if
+
+        size_t l_NbrOfBytes = ((a_Value <= 0xFF) ? 1 : ((a_Value <= 0xFFFF) ? 2 : ((a_Value <= 0xFFFFFFFF) ? 4 : 8)));
+        a_Pos[0] = char(l_Major | ((l_NbrOfBytes == 1) ? 24 : ((l_NbrOfBytes == 2) ? 25 : ((l_NbrOfBytes == 4) ? 26 : 27))));
+        for (size_t l_Index = 0; l_Index < l_NbrOfBytes; ++l_Index) {
+            a_Pos[1 + l_Index] = char(a_Value >> (8 * (l_NbrOfBytes - 1 - l_Index)));
+        } // for
+
+        return (1 + l_NbrOfBytes);
+    }
+
+    static char* AppendLiteral(char* a_Pos, const char* a_Literal) {
+        while (*a_Literal) {
+            *a_Pos++ = *a_Literal++;
+        } // while
+
+        return a_Pos;
+    }
+
+    static char* AppendDecimal(char* a_Pos, uint64_t a_Value) {
+        char l_Digits[20];
+        size_t l_NbrOfDigits = 0;
+        do {
+            l_Digits[l_NbrOfDigits++] = char('0' + (a_Value % 10));
+            a_Value /= 10;
+        } while (a_Value);
+
+        while (l_NbrOfDigits) {
+            *a_Pos++ = l_Digits[--l_NbrOfDigits];
+        } // while
+
+        return a_Pos;
+    }
+
+    static char* AppendBase64(char* a_Pos, const unsigned char* a_Data, size_t a_Length) {
+        static const char s_Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        size_t l_Index = 0;
+        for (; (l_Index + 3) <= a_Length; l_Index += 3) {
+            uint32_t l_Triple = ((uint32_t(a_Data[l_Index]) << 16) | (uint32_t(a_Data[l_Index + 1]) << 8) | a_Data[l_Index + 2]);
+            *a_Pos++ = s_Alphabet[(l_Triple >> 18) & 0x3F];
+            *a_Pos++ = s_Alphabet[(l_Triple >> 12) & 0x3F];
+            *a_Pos++ = s_Alphabet[(l_Triple >> 6) & 0x3F];
+            *a_Pos++ = s_Alphabet[l_Triple & 0x3F];
+        } // for
+
+        if (l_Index < a_Length) {
+            // One or two bytes left, pad with '='
+            uint32_t l_Triple = (uint32_t(a_Data[l_Index]) << 16);
+            if ((l_Index + 1) < a_Length) {
+                l_Triple |= (uint32_t(a_Data[l_Index + 1]) << 8);
+            } // if
+
+            *a_Pos++ = s_Alphabet[(l_Triple >> 18) & 0x3F];
+            *a_Pos++ = s_Alphabet[(l_Triple >> 12) & 0x3F];
+            *a_Pos++ = (((l_Index + 1) < a_Length) ? s_Alphabet[(l_Triple >> 6) & 0x3F] : '=');
+            *a_Pos++ = '=';
+        } // if
+
+        return a_Pos;
+    }
+
+    static char* AppendJsonChar(char* a_Pos, unsigned char a_Char) {
+        static const char s_HexDigits[] = "0123456789abcdef";
+        if ((a_Char == '"') || (a_Char == '\\')) {
+            *a_Pos++ = '\\';
+            *a_Pos++ = char(a_Char);
+        } else if ((a_Char < 0x20) || (a_Char >= 0x7F)) {
+            // Control characters and non-ASCII bytes are escaped, the output is plain ASCII
+            *a_Pos++ = '\\';
+            *a_Pos++ = 'u';
+            *a_Pos++ = '0';
+            *a_Pos++ = '0';
+            *a_Pos++ = s_HexDigits[a_Char >> 4];
+            *a_Pos++ = s_HexDigits[a_Char & 0x0F];
+        } else {
+            *a_Pos++ = char(a_Char);
+        } // else
+
+        return a_Pos;
+    }
+
+    static void AppendJsonChar(std::string& a_String, unsigned char a_Char) {
+        char l_Escaped[6];
+        a_String.append(l_Escaped, AppendJsonChar(l_Escaped, a_Char) - l_Escaped);
+    }
+
+    // Members
+    E_OUTPUT_FORMAT m_OutputFormat;
+    bool m_bTextPayload;
+    std::string m_Device; // Pre-encoded start of each record
+};
+
+#endif // STRUCTURED_PRINTER_H
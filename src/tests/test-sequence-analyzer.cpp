@@ -0,0 +1,107 @@
+/**
+ * \file test-sequence-analyzer.cpp
+ * \brief 
+ *
+ * Additional tools to be used together with the HDLC Daemon.
+ * Copyright (C) 2016  Florian Evers, florian-evers@gmx.de
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "SequenceAnalyzer.h"
+
+static int s_NbrOfFailures = 0;
+
+static void Expect(const std::string& a_Output, const std::string& a_Expected) {
+    if (a_Output.find(a_Expected) == std::string::npos) {
+        std::cerr << "FAILED: \"" << a_Expected << "\" not found in:\n" << a_Output << std::endl;
+        ++s_NbrOfFailures;
+    } // if
+}
+
+static HdlcdPacketData IFrame(bool a_bWasSent, unsigned char a_Ns, unsigned char a_Nr, unsigned char a_Info, bool a_bInvalid = false) {
+    std::vector<unsigned char> l_Frame = { 0x01, (unsigned char)((a_Nr << 5) | (a_Ns << 1)), a_Info, a_Info, 0x00, 0x00 };
+    return HdlcdPacketData::CreatePacket(l_Frame, true, a_bInvalid, a_bWasSent);
+}
+
+static HdlcdPacketData SFrame(bool a_bWasSent, unsigned char a_Type, unsigned char a_Nr) {
+    std::vector<unsigned char> l_Frame = { 0x01, (unsigned char)((a_Nr << 5) | (a_Type << 2) | 0x01), 0x00, 0x00 };
+    return HdlcdPacketData::CreatePacket(l_Frame, true, false, a_bWasSent);
+}
+
+static HdlcdPacketData UFrame(bool a_bWasSent, unsigned char a_Control) {
+    std::vector<unsigned char> l_Frame = { 0x01, a_Control, 0x00, 0x00 };
+    return HdlcdPacketData::CreatePacket(l_Frame, true, false, a_bWasSent);
+}
+
+int main() {
+    // A lost frame followed by a go-back-N resend: I(2) arrives broken, I(3) reveals the gap, the peer rejects with N(R)=2,
+    // and I(2) and I(3) are sent again. Only I(2) contributes to the goodput a second time, I(3) is a duplicate.
+    std::stringstream l_Log;
+    SequenceAnalyzer l_SequenceAnalyzer(l_Log);
+    l_SequenceAnalyzer.OnData(IFrame(true, 0, 0, 0xA0));
+    l_SequenceAnalyzer.OnData(IFrame(true, 1, 0, 0xA1));
+    l_SequenceAnalyzer.OnData(IFrame(true, 2, 0, 0xA2, true));
+    l_SequenceAnalyzer.OnData(IFrame(true, 3, 0, 0xA3));
+    l_SequenceAnalyzer.OnData(SFrame(false, 0x02, 2));
+    l_SequenceAnalyzer.OnData(IFrame(true, 2, 0, 0xA2));
+    l_SequenceAnalyzer.OnData(IFrame(true, 3, 0, 0xA3));
+    l_SequenceAnalyzer.OnData(IFrame(true, 4, 0, 0xA4));
+    l_SequenceAnalyzer.PrintStatistics();
+
+    const std::string l_Output = l_Log.str();
+    Expect(l_Output, "<<< Sent gap: expected N(S)=2, got N(S)=3, 1 frames missing");
+    Expect(l_Output, ">>> Rcvd REJ N(R)=2");
+    Expect(l_Output, "<<< Sent retransmission N(S)=2, 2 bytes\n");
+    Expect(l_Output, "<<< Sent retransmission N(S)=3, 2 bytes, duplicate");
+    Expect(l_Output, "Sent: 6 I-frames, 2 retransmissions");
+    Expect(l_Output, "1 duplicates), 1 gaps with 1 missing frames, 0 REJ");
+    Expect(l_Output, "Rcvd: 0 I-frames");
+    Expect(l_Output, "Broken frames: 1");
+    if (l_SequenceAnalyzer.GetGoodputBytes(true) != (5 * 2)) {
+        std::cerr << "FAILED: goodput of " << l_SequenceAnalyzer.GetGoodputBytes(true) << " bytes instead of 10" << std::endl;
+        ++s_NbrOfFailures;
+    } // if
+
+    if (l_Output.find("6 frames missing") != std::string::npos) {
+        std::cerr << "FAILED: the resend was counted as a gap" << std::endl;
+        ++s_NbrOfFailures;
+    } // if
+
+    // A UI-frame in between does not reset the sequence numbers: the resend of I(1) is still detected as a duplicate,
+    // whereas a SABM starts over.
+    std::stringstream l_UiLog;
+    SequenceAnalyzer l_UiSequenceAnalyzer(l_UiLog);
+    l_UiSequenceAnalyzer.OnData(IFrame(true, 0, 0, 0xB0));
+    l_UiSequenceAnalyzer.OnData(IFrame(true, 1, 0, 0xB1));
+    l_UiSequenceAnalyzer.OnData(UFrame(false, 0x13));
+    l_UiSequenceAnalyzer.OnData(IFrame(true, 1, 0, 0xB1));
+    l_UiSequenceAnalyzer.OnData(UFrame(false, 0x3F));
+    l_UiSequenceAnalyzer.OnData(IFrame(true, 1, 0, 0xB1));
+    l_UiSequenceAnalyzer.PrintStatistics();
+
+    const std::string l_UiOutput = l_UiLog.str();
+    Expect(l_UiOutput, "<<< Sent retransmission N(S)=1, 2 bytes, duplicate");
+    Expect(l_UiOutput, "Sent: 4 I-frames, 1 retransmissions");
+    if (l_UiSequenceAnalyzer.GetGoodputBytes(true) != (3 * 2)) {
+        std::cerr << "FAILED: goodput of " << l_UiSequenceAnalyzer.GetGoodputBytes(true) << " bytes instead of 6" << std::endl;
+        ++s_NbrOfFailures;
+    } // if
+
+    return (s_NbrOfFailures ? 1 : 0);
+}